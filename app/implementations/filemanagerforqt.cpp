@@ -74,6 +74,26 @@ std::string FileManagerForQt::getLogFilePath(const std::string &logname) const
 }
 
 
+//-----------------------------------------------------------------------------
+//                        Return path of a cache file
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Returns the path of the cache file with the given filename.
+///
+/// Returns the full path of the file in the application cache directory.
+/// The function does not check whether the file actually exists
+/// \param filename : Name of the cache file
+/// \return : String containing the path to the cache file
+///////////////////////////////////////////////////////////////////////////////
+
+std::string FileManagerForQt::getCacheFilePath(const std::string &filename) const
+{
+    QDir directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    return directory.absoluteFilePath(QString::fromStdString(filename)).toStdString();
+}
+
+
 //-----------------------------------------------------------------------------
 //    Read the content of the XML file of an algorithm with the given ID
 //-----------------------------------------------------------------------------
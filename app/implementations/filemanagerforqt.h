@@ -41,6 +41,9 @@ public:
     // Return the path of the log file with the given logname.
     virtual std::string getLogFilePath (const std::string &logname) const override final;
 
+    // Return the path of the cache file with the given filename.
+    virtual std::string getCacheFilePath (const std::string &filename) const override final;
+
     // Read the content of the XML file of an algorithm with the given ID
     virtual std::wstring getAlgorithmInformationFileContent (const std::string &algorithmId) const override final;
 };
@@ -234,8 +234,10 @@ void KeyboardGraphicsView::handleMessage(MessagePtr m) {
         break;
     case Message::MSG_KEY_DATA_CHANGED: {
         auto mkdc(std::static_pointer_cast<MessageKeyDataChanged>(m));
-        updateColorMarker(mkdc->getIndex());
-        setKeyColor(mkdc->getIndex());
+        for (int index : mkdc->getIndices()) {
+            updateColorMarker(index);
+            setKeyColor(index);
+        }
         // update key
         break;
     }
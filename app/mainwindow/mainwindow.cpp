@@ -26,6 +26,7 @@
 #include "../core/messages/messagekeyselectionchanged.h"
 #include "../core/messages/messagerecorderenergychanged.h"
 #include "../core/messages/messagefinalkey.h"
+#include "../core/messages/messagekeydelta.h"
 #include "../core/messages/messagecaluclationprogress.h"
 #include "../core/messages/messagenewfftcalculated.h"
 #include "../core/messages/messagesignalanalysis.h"
@@ -522,6 +523,14 @@ void MainWindow::handleMessage(MessagePtr m) {
         updateFrequency(keyptr.get());
         break;
     }
+    case Message::MSG_KEY_DELTA: {
+        auto message(std::static_pointer_cast<MessageKeyDelta>(m));
+        if (message->has(MessageKeyDelta::TUNED_FREQUENCY) and
+                message->getKeyNumber() == mKeyboardGraphicsView->getSelectedKeyIndex()) {
+            mSignalAnalyzerGroup->setFrequency(QString("%1").arg(message->getTunedFrequency(), 0, 'f', 1));
+        }
+        break;
+    }
     case Message::MSG_CALCULATION_PROGRESS: {
         auto mcp(std::static_pointer_cast<MessageCaluclationProgress>(m));
         switch (mcp->getCalculationType()) {
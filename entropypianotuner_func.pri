@@ -100,7 +100,12 @@ defineReplace(depends_dirent) {
 defineReplace(depends_fftw3) {
     fftw3 {
         contains(EPT_THIRDPARTY_CONFIG, system_fftw3) {
+            contains(EPT_CONFIG, fftw_threads) {
+                LIBS += -lfftw3_threads
+                contains(EPT_CONFIG, single_precision_fft):LIBS += -lfftw3f_threads
+            }
             LIBS += -lfftw3
+            contains(EPT_CONFIG, single_precision_fft):LIBS += -lfftw3f
         } else {
             include($$EPT_THIRDPARTY_DIR/fftw3/fftw3_export.pri)
             INCLUDEPATH += $$FFTW_INCLUDE_PATHS
@@ -57,6 +57,11 @@ linux-g++*:!android {
 contains(EPT_CONFIG, no_shared_algorithms):DEFINES+="EPT_NO_SHARED_ALGORITHMS=1" "EPT_STATIC_ALGORITHMS=1"
 contains(EPT_CONFIG, shared_algorithms):DEFINES+="EPT_SHARED_ALGORITHMS=1"
 
+# single precision signal analysis (requires fftw3f), e.g. qmake EPT_CONFIG+=single_precision_fft
+contains(EPT_CONFIG, single_precision_fft):DEFINES+="CONFIG_SINGLE_PRECISION_FFT=1"
+# multithreaded transforms of large signals (requires fftw3_threads), e.g. qmake EPT_CONFIG+=fftw_threads
+contains(EPT_CONFIG, fftw_threads):DEFINES+="CONFIG_FFTW_THREADS=1"
+
 # set QWT_CONFIG for static/dynamic build
 contains(EPT_CONFIG, static_qwt):QWT_CONFIG += QwtStatic
 else:QWT_CONFIG += QwtDll
@@ -43,7 +43,8 @@ namespace entropyminimizer
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Constructor
 ///
-/// Initializes the member variables.
+/// Initializes the member variables. Since the bins have a fixed spacing
+/// of one cent, the frequencies of the bins are tabulated once.
 ///////////////////////////////////////////////////////////////////////////////
 
 AuditoryPreprocessing::AuditoryPreprocessing (Piano &piano) :
@@ -52,8 +53,18 @@ AuditoryPreprocessing::AuditoryPreprocessing (Piano &piano) :
     mKeys(mKeyboard.getKeys()),
     mNumberOfKeys(mKeyboard.getNumberOfKeys()),
     mKeyNumberOfA4(mKeyboard.getKeyNumberOfA4()),
-    mdBA()
+    mFrequencies(NumberOfBins),
+    mFrequencyPowers(NumberOfBins),
+    mdBA(),
+    mSPLAGain(),
+    mMollifierKernels(),
+    mMollifierWeights()
 {
+    for (size_t m=0; m<NumberOfBins; ++m)
+    {
+        mFrequencies[m] = mtof(static_cast<int>(m));
+        mFrequencyPowers[m] = pow(mFrequencies[m],1.5);
+    }
 }
 
 
@@ -224,6 +235,10 @@ double AuditoryPreprocessing::getInharmonicPartialIndex (double f, double f1, do
 /// previous determination of the inharmonicity do not load to an
 /// errorneous cancellation of higher partials.
 ///
+/// The envelope depends on f1 and B, hence it has to be computed for each
+/// key. Bins which are already zero (e.g. after cutLowFrequencies) are
+/// skipped, the frequencies of the bins are taken from a table.
+///
 /// \param key : Reference to the key
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -231,15 +246,16 @@ void AuditoryPreprocessing::cleanSpectrum (Key &key)
 {
     SpectrumType &spectrum = key.getSpectrum();
     const int M = static_cast<int>(spectrum.size());
+    EptAssert(M <= static_cast<int>(NumberOfBins), "Spectrum too long");
     const double f = key.getRecordedFrequency();
     const double B = key.getMeasuredInharmonicity();
+    const double exponent = 200.0 * pow(f,1.5);
 
-    auto wave = [f,B,this] (int m)
-        { return cos(MathTools::PI*getInharmonicPartialIndex(mtof(m),f,B)); };
-    auto envelope = [wave,f] (int m)
-        { return  pow(fabs(wave(m)),200.0/pow(mtof(m)/f,1.5)); };
-
-    for (int m=0; m<M; m++) spectrum[m] *= envelope(m);
+    for (int m=0; m<M; m++) if (spectrum[m] != 0)
+    {
+        const double wave = cos(MathTools::PI*getInharmonicPartialIndex(mFrequencies[m],f,B));
+        spectrum[m] *= pow(fabs(wave),exponent/mFrequencyPowers[m]);
+    }
 }
 
 
@@ -274,19 +290,22 @@ void AuditoryPreprocessing::cutLowFrequencies(Key &key)
 /// given by \f[ _A(f)= {12200^2\cdot f^4\over (f^2+20.6^2)
 /// \quad\sqrt{(f^2+107.7^2)\,(f^2+737.9^2)} \quad (f^2+12200^2)}\f]
 /// For the sake of efficiency the values according to the logarithmically binned
-/// spectra are stored in a vector mdBA.
+/// spectra are stored in a vector mdBA. In addition, the corresponding factors
+/// by which the intensities are multiplied are stored in mSPLAGain.
 ///////////////////////////////////////////////////////////////////////////////
 
 void AuditoryPreprocessing::initializeSPLAFilter()
 {
     mdBA.clear();
     mdBA.resize(NumberOfBins);
+    mSPLAGain.resize(NumberOfBins);
     for (uint m=0; m<NumberOfBins; ++m)
     {
-        double f = mtof(m);
+        double f = mFrequencies[m];
         double Ra = 12200.0*12200.0*f*f*f*f / (f*f+20.6*20.6) /
                sqrt((f*f+107.7*107.7)*(f*f+737.9*737.9)) / (f*f+12200.0*12200.0);
         mdBA[m] = 2.0+20*log10(Ra);
+        mSPLAGain[m] = pow(10.0, mdBA[m]/10.0);
         //std::cout << f << "\t" << mdBA[m] << std::endl;
     }
 }
@@ -305,19 +324,25 @@ void AuditoryPreprocessing::initializeSPLAFilter()
 /// stored in the same spectrum vector of the local copy, destroying the
 /// existing data which is not used for tuning.
 ///
+/// Converting the intensity to decibels, adding the dBA curve and
+/// converting back amounts to a multiplication by the tabulated gain,
+/// so that no transcendental functions are needed here.
+///
 /// \param spectrum : Reference to the spectrum
 ///////////////////////////////////////////////////////////////////////////////
 
 void AuditoryPreprocessing::convertToSPLA (SpectrumType &spectrum)
 {
     if (mdBA.size()==0) initializeSPLAFilter();
-    EptAssert(mdBA.size()==NumberOfBins,"mdBA should be initialized.");
+    EptAssert(mSPLAGain.size()==NumberOfBins,"mdBA should be initialized.");
+    EptAssert(spectrum.size()==NumberOfBins,"Spectrum has wrong size.");
     const double I0 = 1E-7;	// auditory threshold intensity
+    const double *gain = mSPLAGain.data();
+    double *s = spectrum.data();
     for (uint m=0; m<NumberOfBins; ++m)
     {
-        double SPLA = 10 * log10(spectrum[m]/I0)  + mdBA[m];
-        if (SPLA<0) spectrum[m]=0;
-        else spectrum[m] = I0 * pow(10.0, SPLA/10.0);
+        const double intensity = s[m] * gain[m];
+        s[m] = (intensity < I0 ? 0 : intensity);
     }
 }
 
@@ -411,33 +436,89 @@ void AuditoryPreprocessing::improveHighFrequencyPeaks ()
 
 
 //-----------------------------------------------------------------------------
-//                  Mollify
+//                  Tabulate the mollifier kernels
 //-----------------------------------------------------------------------------
 
-void AuditoryPreprocessing::applyMollifier (Key &key)
-{
-    SpectrumType &spectrum = key.getSpectrum();
-    SpectrumType copy = spectrum;
-    //double f1 = key.getRecordedFrequency();
-
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Tabulate the weights of the mollifier
+///
+/// The mollifier replaces each bin m by a Gaussian average over the bins
+/// m-3*dm...m+3*dm, where the width dm depends on the frequency of the bin.
+/// Since the bins are fixed, the normalized weights are functions of the
+/// bin index alone. They are computed once and stored contiguously in
+/// mMollifierWeights, while mMollifierKernels holds the location of the
+/// kernel of each bin. The function has to be called before the keys are
+/// mollified in parallel.
+///////////////////////////////////////////////////////////////////////////////
 
-    //SpectrumType copy = spectrum;
-    int M = static_cast<int>(NumberOfBins);
+void AuditoryPreprocessing::initializeMollifier()
+{
+    const int M = static_cast<int>(NumberOfBins);
+    mMollifierKernels.resize(M);
+    mMollifierWeights.clear();
     for (int m=0; m<M; ++m)
     {
-        double f = mtof(m);
+        MollifierKernel &kernel = mMollifierKernels[m];
+        const double f = mFrequencies[m];
         const double df=55.0/f+f/2000.0;
-        int dm = MathTools::roundToInteger(ftom(f+df)) - m;
-        double sum=0,norm=0;
-        for (int ms = std::max(1,m-3*dm); ms<=std::min(m+3*dm,M-1); ms++)
+        const int dm = MathTools::roundToInteger(ftom(f+df)) - m;
+        kernel.first = std::max(1,m-3*dm);
+        kernel.offset = static_cast<int>(mMollifierWeights.size());
+        kernel.size = 0;
+        if (dm <= 0) continue;
+
+        const int last = std::min(m+3*dm,M-1);
+        double norm = 0;
+        for (int ms = kernel.first; ms <= last; ms++)
         {
             double weight = exp(-1.0*(ms-m)*(ms-m)/dm/dm);
-            norm+=weight;
-            sum+=copy[ms]*weight;
+            mMollifierWeights.push_back(weight);
+            norm += weight;
+        }
+        if (norm <= 0)
+        {
+            mMollifierWeights.resize(kernel.offset);
+            continue;
         }
-        if (norm>0) spectrum[m]=sum/norm;
+        kernel.size = last - kernel.first + 1;
+        for (int i=0; i<kernel.size; ++i) mMollifierWeights[kernel.offset+i] /= norm;
     }
+}
+
 
+//-----------------------------------------------------------------------------
+//                  Mollify
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Smoothen the spectral lines by a Gaussian of frequency-dependent width
+///
+/// The weights are taken from the table computed in initializeMollifier(),
+/// so that each bin only requires a dot product of the kernel with the
+/// original spectrum. The function only modifies the spectrum of the given
+/// key, hence it can be called for several keys in parallel, provided that
+/// each thread passes a buffer of its own.
+/// \param key : Reference to the key
+/// \param buffer : Scratch buffer holding a copy of the original spectrum
+///////////////////////////////////////////////////////////////////////////////
+
+void AuditoryPreprocessing::applyMollifier (Key &key, SpectrumType &buffer)
+{
+    EptAssert(mMollifierKernels.size()==NumberOfBins,"Mollifier should be initialized.");
+    SpectrumType &spectrum = key.getSpectrum();
+    EptAssert(spectrum.size()==NumberOfBins,"Spectrum has wrong size.");
+    buffer = spectrum;
+
+    const int M = static_cast<int>(NumberOfBins);
+    for (int m=0; m<M; ++m)
+    {
+        const MollifierKernel &kernel = mMollifierKernels[m];
+        const double *weight = mMollifierWeights.data() + kernel.offset;
+        const double *copy = buffer.data() + kernel.first;
+        double sum = 0;
+        for (int i=0; i<kernel.size; ++i) sum += weight[i] * copy[i];
+        if (kernel.size > 0) spectrum[m] = sum;
+    }
 }
 
 
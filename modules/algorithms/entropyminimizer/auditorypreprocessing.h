@@ -64,19 +64,33 @@ public:
 
     void extrapolateInharmonicity();
     void improveHighFrequencyPeaks();
-    void applyMollifier(Key &key);
+    void initializeMollifier();     // tabulate the mollifier kernels
+    void applyMollifier(Key &key, SpectrumType &buffer);
 
 
 private:
     static double ftom (double f) { return Key::FrequencyToRealIndex(f); }
     static double mtof (int m)    { return Key::IndexToFrequency(m); }
 
+    /// Location of the tabulated mollifier weights of a single bin
+    struct MollifierKernel
+    {
+        int first;                      ///< Index of the first bin covered by the kernel
+        int offset;                     ///< Index of the first weight in mMollifierWeights
+        int size;                       ///< Number of weights, 0 if the bin is kept
+    };
+
     Piano &mPiano;
     Keyboard &mKeyboard;
     Keys &mKeys;
     int mNumberOfKeys;
     int mKeyNumberOfA4;
+    std::vector<double> mFrequencies;   // frequencies of the bins
+    std::vector<double> mFrequencyPowers; // frequencies of the bins to the power 1.5
     std::vector<double> mdBA;           // vector holding dBA curve
+    std::vector<double> mSPLAGain;      // dBA curve as a factor of the intensity
+    std::vector<MollifierKernel> mMollifierKernels; // kernels of all bins
+    std::vector<double> mMollifierWeights;          // normalized weights of all kernels
 
 };
 
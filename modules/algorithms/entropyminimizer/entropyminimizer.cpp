@@ -27,6 +27,10 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <limits>
 
 #include "core/system/eptexception.h"
 #include "core/piano/piano.h"
@@ -38,10 +42,18 @@
 #include "core/messages/messagecaluclationprogress.h"
 
 #include "auditorypreprocessing.h"
+#include "preprocessingcache.h"
 
 
 ALGORITHM_CPP_START(entropyminimizer)
 
+const int EntropyMinimizer::FLUCTUATION_WIDTH;          // width of the fluctuations (see header)
+const int EntropyMinimizer::TRIALS_PER_EXCHANGE;        // trials between synchronizations (see header)
+const int EntropyMinimizer::MAXIMAL_NUMBER_OF_CHAINS;   // upper bound for the chains (see header)
+const int EntropyMinimizer::GREEDY_WINDOW;              // range of a greedy step (see header)
+const int EntropyMinimizer::MAXIMAL_COARSE_SWEEPS;      // sweeps on a coarse grid (see header)
+const int EntropyMinimizer::CONVERGENCE_WINDOW;         // window of the stopping criterion (see header)
+
 //-----------------------------------------------------------------------------
 //                             Constructor
 //-----------------------------------------------------------------------------
@@ -54,7 +66,11 @@ ALGORITHM_CPP_START(entropyminimizer)
 EntropyMinimizer::EntropyMinimizer(const Piano &piano,
                                    const AlgorithmFactoryDescription &description) :
     Algorithm(piano, description),
-    mAccumulator(NumberOfBins),
+    mFineGrid(),
+    mCoarseGrid(),
+    mGrid(&mFineGrid),
+    mChains(),
+    mGreedy(false),
     mPitch(mNumberOfKeys),
     mInitialPitch(mNumberOfKeys),
     mRecalculateEntropy(false),
@@ -137,18 +153,21 @@ void EntropyMinimizer::handleMessage(MessagePtr m)
         case Message::MSG_CHANGE_TUNING_CURVE:
         {
             auto message(std::static_pointer_cast<MessageChangeTuningCurve>(m));
-            double f = message->getFrequency();
-            int keynumber = message->getKeyNumber();
-            if (keynumber>=0) if (f != mKeyboard[keynumber].getComputedFrequency())
+            for (auto &change : message->getFrequencies())
             {
-                LogI ("Manual change of tuning curve during computation");
-                mRecalculateEntropy = true;
-                mRecalculateFrequency = f;
-                mRecalculateKey = keynumber;
+                double f = change.second;
+                int keynumber = change.first;
+                if (keynumber>=0) if (f != mKeyboard[keynumber].getComputedFrequency())
+                {
+                    LogI ("Manual change of tuning curve during computation");
+                    mRecalculateEntropy = true;
+                    mRecalculateFrequency = f;
+                    mRecalculateKey = keynumber;
 #if CONFIG_ENABLE_XMGRACE
-                writeSpectrum(keynumber,"modified",mPitch[keynumber]-getRecordedPitchET440(keynumber));
+                    writeSpectrum(keynumber,"modified",mPitch[keynumber]-getRecordedPitchET440(keynumber));
 #endif // CONFIG_ENABLE_XMGRACE
 
+                }
             }
         }
         break;
@@ -167,6 +186,16 @@ void EntropyMinimizer::handleMessage(MessagePtr m)
 ///
 /// A large part of the computation is a sensible preprocessing of the
 /// logarithmically binned spectra.
+///
+/// Most of the preprocessing steps only depend on the spectrum of the key
+/// itself. These steps are carried out for all keys in parallel. The steps
+/// involving several keys (extrapolation of the inharmonicity and the
+/// improvement of the high-frequency peaks) act as serial barriers in
+/// between.
+///
+/// If the same recorded data was preprocessed before, the result is taken
+/// from the PreprocessingCache (optionally backed by a file, parameter
+/// "diskcache").
 ///////////////////////////////////////////////////////////////////////////////
 
 bool EntropyMinimizer::performAuditoryPreprocessing()
@@ -180,39 +209,25 @@ bool EntropyMinimizer::performAuditoryPreprocessing()
 
     if (not AP.checkDataConsistency()) return false;
 
-    LogI("EntropyMinimzer: Normalize spectra ");
-    for (auto &key : mKeys)
-    {
-        AP.normalizeSpectrum(key);
-        showCalculationProgress(key,0,0.25);
-        if (cancelThread()) return false;
-    }
-
-    LogI("EntropyMinimzer: Clean spectra ");
-    for (auto &key : mKeys)
-    {
-        AP.cleanSpectrum(key);
-        showCalculationProgress(key,0.25,0.25);
-        if (cancelThread()) return false;
-    }
-
-    LogI("EntropyMinimizer: Cut low frequencies ");
-    for (auto &key : mKeys)
+    const bool useCacheFile = mParameters->getBoolParameter("diskcache");
+    const uint64_t hash = PreprocessingCache::computeHash(mPiano);
+    if (PreprocessingCache::restore(hash, mPiano, useCacheFile))
     {
-        AP.cutLowFrequencies(key);
-        showCalculationProgress(key,0.5,0.25);
-        if (cancelThread()) return false;
+        LogI("EntropyMinimizer: Preprocessed spectra taken from the cache");
+        showCalculationProgress(0);
+        return true;
     }
 
-    LogI("EntropyMinimzer: Apply SPLA filter");
+    LogI("EntropyMinimzer: Normalize, clean, and cut spectra, apply SPLA filter");
     AP.initializeSPLAFilter();
-    for (auto &key : mKeys)
+    auto prepare = [&AP] (Key &key, SpectrumType &)
     {
-        SpectrumType &spectrum = key.getSpectrum();
-        AP.convertToSPLA(spectrum);
-        showCalculationProgress(key,0.75,0.25);
-        if (cancelThread()) return false;
-    }
+        AP.normalizeSpectrum(key);
+        AP.cutLowFrequencies(key);      // commutes with cleaning, which then
+        AP.cleanSpectrum(key);          // skips the vanishing bins
+        AP.convertToSPLA(key.getSpectrum());
+    };
+    if (not processKeysInParallel(prepare,0,1)) return false;
 
     LogI("EntropyMinimizer: Extrapolate missing inharmonicity values");
     AP.extrapolateInharmonicity();
@@ -233,18 +248,17 @@ bool EntropyMinimizer::performAuditoryPreprocessing()
     AP.improveHighFrequencyPeaks();
 
     LogI("EntropyMinimizer: Mollify spectral lines");
-    for (auto &key : mKeys)
-    {
-        AP.applyMollifier(key);
-        showCalculationProgress(key,0,1);
-        if (cancelThread()) return false;
-    }
+    AP.initializeMollifier();
+    auto mollify = [&AP] (Key &key, SpectrumType &buffer)
+        { AP.applyMollifier(key,buffer); };
+    if (not processKeysInParallel(mollify,0,1)) return false;
 
 
 #if CONFIG_ENABLE_XMGRACE
     for (int k=0; k < mNumberOfKeys; ++k) writeSpectrum(k,"final");
 #endif // CONFIG_ENABLE_XMGRACE
 
+    PreprocessingCache::store(hash, mPiano, useCacheFile);
     showCalculationProgress(0);
     LogI("EntropyMinimizer: Stop auditory preprocessing");
     return true;
@@ -252,6 +266,124 @@ bool EntropyMinimizer::performAuditoryPreprocessing()
 
 
 
+//-----------------------------------------------------------------------------
+//                    Process all keys in parallel threads
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Apply a function to all keys in parallel.
+///
+/// The keys are distributed dynamically among the threads of runInParallel.
+/// The calling thread reports the progress. Each thread owns a scratch
+/// buffer which is passed to the function, hence the function may only
+/// modify the given key and the buffer. The function returns after all
+/// keys have been processed (barrier). Exceptions thrown in one of the
+/// threads are passed on to the caller.
+/// \param process : Function to be applied to each key
+/// \param start : Progress at the beginning
+/// \param range : Range of the progress covered by this step
+/// \return false if the calculation was cancelled
+///////////////////////////////////////////////////////////////////////////////
+
+bool EntropyMinimizer::processKeysInParallel (const KeyProcessor &process,
+                                              double start, double range)
+{
+    std::atomic<int> nextKey(0);
+    std::atomic<int> processedKeys(0);
+    runInParallel(mNumberOfKeys, [&] (int thread, int)
+    {
+        SpectrumType buffer;
+        try
+        {
+            for (int k=nextKey++; k<mNumberOfKeys and not cancelThread(); k=nextKey++)
+            {
+                process(mKeys[k],buffer);
+                int processed = ++processedKeys;
+                if (thread==0) showCalculationProgress(start+range*processed/mNumberOfKeys);
+            }
+        }
+        catch (...)
+        {
+            nextKey = mNumberOfKeys;    // let the other threads stop
+            throw;
+        }
+    });
+    return not cancelThread();
+}
+
+
+//-----------------------------------------------------------------------------
+//                  Run a task in the persistent worker threads
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Run a task in several threads and wait for all of them.
+///
+/// The number of threads is limited by the number of cores. The calling
+/// thread executes the task with index 0, the other indices are passed to
+/// persistent workers which are created on first use and kept for the
+/// lifetime of the minimizer. Exceptions thrown in one of the threads are
+/// passed on to the caller after all threads have finished.
+/// \param maximalNumberOfThreads : Upper bound for the number of threads
+/// \param task : Task to be executed by each thread
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::runInParallel (int maximalNumberOfThreads, const ParallelTask &task)
+{
+    const int numberOfThreads = std::max(1, std::min<int>(maximalNumberOfThreads,
+                                         std::thread::hardware_concurrency()));
+    while (static_cast<int>(mWorkers.size()) < numberOfThreads-1)
+        mWorkers.emplace_back(new Worker());
+
+    for (int t=1; t<numberOfThreads; ++t)
+        mWorkers[t-1]->run([&task,t,numberOfThreads] { task(t,numberOfThreads); });
+
+    std::exception_ptr exception;
+    try { task(0,numberOfThreads); }
+    catch (...) { exception = std::current_exception(); }
+
+    for (int t=1; t<numberOfThreads; ++t)
+    {
+        std::exception_ptr workerException = mWorkers[t-1]->finish();
+        if (workerException and not exception) exception = workerException;
+    }
+    if (exception) std::rethrow_exception(exception);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Submit a task to the worker thread
+/// \param task : The task to be executed
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::Worker::run (std::function<void()> task)
+{
+    mTask = std::move(task);
+    mException = nullptr;
+    start();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Wait for the submitted task to finish
+/// \return Exception thrown by the task, nullptr if none
+///////////////////////////////////////////////////////////////////////////////
+
+std::exception_ptr EntropyMinimizer::Worker::finish()
+{
+    waitForCompletion();
+    return mException;
+}
+
+
+void EntropyMinimizer::Worker::workerFunction()
+{
+    setThreadName("EntropyWorker");
+    try { mTask(); }
+    catch (...) { mException = std::current_exception(); }
+}
+
+
 //-----------------------------------------------------------------------------
 //                     Update the displayed tuning curve
 //-----------------------------------------------------------------------------
@@ -278,13 +410,36 @@ void EntropyMinimizer::updateTuningcurve (int keynumber)
 ///
 /// This function translates the all mPitch values into the corresponding
 /// frequencies, stores the values in the local piano copy mPiano and sends a
-/// sequence of messages that the tuning curve has to be redrawn.
+/// single message that the tuning curve has to be redrawn.
 ///////////////////////////////////////////////////////////////////////////////
 
 void EntropyMinimizer::updateTuningcurve ()
 {
+    std::map<int,double> frequencies;
+    for (int keynumber = 0; keynumber < mNumberOfKeys; ++keynumber)
+        frequencies[keynumber] = mPiano.getDefiningTempFrequency(keynumber, mPitch[keynumber],440);
+    updateTuningCurve(frequencies);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Display the pitches of a given Monte Carlo chain
+///
+/// The keys whose pitch differs from the displayed one are collected and
+/// sent in a single message.
+/// \param chain : Monte Carlo chain to be displayed
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::publishChain (const Chain &chain)
+{
+    std::map<int,double> frequencies;
     for (int keynumber = 0; keynumber < mNumberOfKeys; ++keynumber)
-        updateTuningcurve(keynumber);
+    {
+        if (chain.pitch[keynumber] == mPitch[keynumber]) continue;
+        mPitch[keynumber] = chain.pitch[keynumber];
+        frequencies[keynumber] = mPiano.getDefiningTempFrequency(keynumber, mPitch[keynumber],440);
+    }
+    if (not frequencies.empty()) updateTuningCurve(frequencies);
 }
 
 
@@ -294,7 +449,7 @@ void EntropyMinimizer::updateTuningcurve ()
 
 void EntropyMinimizer:: clear()
 {
-    mAccumulator.assign(NumberOfBins,0);
+    mChains.clear();
     mPitch.assign(mNumberOfKeys,0);
     mInitialPitch.assign(mNumberOfKeys,0);
 }
@@ -316,30 +471,144 @@ double EntropyMinimizer::getElement (SpectrumType &spectrum, int m)
 }
 
 
+//-----------------------------------------------------------------------------
+//                   Construct the sparse form of the spectra
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Construct the sparse form of the spectra of all keys on a grid.
+///
+/// After auditory preprocessing the spectra do not change anymore. For
+/// each key the bins between the cutoffs are summed up in groups of binSize
+/// bins and every sequence of contiguous nonzero values is stored as a
+/// SpectralRun. Keys without any spectral content get an empty list of runs.
+///
+/// At full resolution (binSize=1) the reference pitch of a key is its
+/// recorded pitch. On a coarse grid the spectra are aligned with the
+/// current pitches mPitch before downsampling, so that these pitches are
+/// the reference and shifting a spectrum by one bin corresponds to a
+/// change of the pitch by binSize cents.
+/// \param grid : Grid to be constructed
+/// \param binSize : Number of cents per bin
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::constructGrid (Grid &grid, int binSize)
+{
+    EptAssert(binSize>0,"Bin size has to be positive");
+    grid.binSize = binSize;
+    grid.numberOfBins = NumberOfBins / binSize;
+    grid.spectra.assign(mNumberOfKeys,SparseSpectrum());
+    grid.referencePitch.resize(mNumberOfKeys);
+    SpectrumType binned(grid.numberOfBins);
+    for (int k=0; k<mNumberOfKeys; ++k)
+    {
+        const int recorded_pitch = getRecordedPitchET440AsInt(k);
+        const int offset = (binSize == 1 ? 0 : mPitch[k] - recorded_pitch);
+        grid.referencePitch[k] = recorded_pitch + offset;
+
+        SpectrumType &spectrum = mKeys[k].getSpectrum();
+        binned.assign(grid.numberOfBins,0);
+        for (int m=mLowerCutoff+1; m<mUpperCutoff; ++m)
+        {
+            const int j = (m + offset) / binSize;
+            if (m + offset >= 0 and j < grid.numberOfBins) binned[j] += getElement(spectrum,m);
+        }
+
+        SparseSpectrum &runs = grid.spectra[k];
+        bool inside = false;
+        for (int j=0; j<grid.numberOfBins; ++j)
+        {
+            double y = binned[j];
+            if (y == 0) { inside = false; continue; }
+            if (not inside) runs.push_back({j, {}});
+            runs.back().values.push_back(y);
+            inside = true;
+        }
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Number of bins by which the spectrum of a key is shifted.
+/// \param keynumber : Number of the key
+/// \param pitch : Pitch of the key in cents
+/// \return Shift in units of the bins of the current grid
+///////////////////////////////////////////////////////////////////////////////
+
+int EntropyMinimizer::getShift (int keynumber, int pitch) const
+{
+    const int pitchdiff = pitch - mGrid->referencePitch[keynumber];
+    EptAssert(pitchdiff % mGrid->binSize == 0,"Pitch has to lie on the grid");
+    return pitchdiff / mGrid->binSize;
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Add a sparse spectrum to a vector
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Add the shifted sparse spectrum of a key to a given vector.
+/// \param target : Vector of the size of the grid to which the spectrum is added
+/// \param keynumber : Number of the key
+/// \param shift : number of bins by which the spectrum is shifted
+/// \param intensity : weight at wich the spectrum is added (+) or subtracted (-).
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::addSparseSpectrum (SpectrumType &target, int keynumber,
+                                          int shift, double intensity) const
+{
+    for (const SpectralRun &run : mGrid->spectra[keynumber])
+    {
+        const int size = static_cast<int>(run.values.size());
+        const int first = std::max(0, -shift-run.first);
+        const int last  = std::min(size, mGrid->numberOfBins-shift-run.first);
+        const int offset = run.first + shift;
+        for (int i=first; i<last; ++i) target[offset+i] += run.values[i] * intensity;
+    }
+}
+
+
 //-----------------------------------------------------------------------------
 //                     Add spectrum to the accumulator
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Add or subtract a spectrum to the accumulator.
+/// \brief Add or subtract the spectrum of a key to the accumulator.
 ///
 /// Since the entropy is computed from the accumulator, the accmulator values
 /// have a probability interpretation. Therfore, spectra should be added
-/// \param spectrum : Logarithmic spectrum
+/// with a positive weight. Only the bins covered by the sparse spectrum
+/// of the key are visited. For each modified bin the sums chain.norm
+/// and chain.xlogx are corrected accordingly.
+/// \param chain : Monte Carlo chain holding the accumulator
+/// \param keynumber : Number of the key
 /// \param shift : number of bins by which the spectrum is shifted
 /// \param intensity : weight at wich the spectrum is added (+) or subtracted (-).
 ///////////////////////////////////////////////////////////////////////////////
 
-void EntropyMinimizer::addToAccumulator (SpectrumType &spectrum,
-                                         int shift, double intensity)
+void EntropyMinimizer::addToAccumulator (Chain &chain, int keynumber,
+                                         int shift, double intensity) const
 {
-    for (int m=0; m<NumberOfBins; ++m)
+    for (const SpectralRun &run : mGrid->spectra[keynumber])
     {
-        mAccumulator[m] += getElement(spectrum,m-shift) * intensity;
-        // Tiny negative values are possible and will be truncated here:
-        if (mAccumulator[m]<0 and mAccumulator[m]>-1E-10) mAccumulator[m] = 0;
-        // Larger negative values will lead to an exception
-        EptAssert(mAccumulator[m] >= 0,"negative intensities are inconsistent");
+        const int size = static_cast<int>(run.values.size());
+        const int first = std::max(0, -shift-run.first);
+        const int last  = std::min(size, mGrid->numberOfBins-shift-run.first);
+        const int offset = run.first + shift;
+        for (int i=first; i<last; ++i)
+        {
+            double &a = chain.accumulator[offset+i];
+            chain.norm -= a;
+            chain.xlogx -= MathTools::xlogx(a);
+            a += run.values[i] * intensity;
+            // Tiny negative values are possible and will be truncated here:
+            if (a<0 and a>-1E-10) a = 0;
+            // Larger negative values will lead to an exception
+            EptAssert(a >= 0,"negative intensities are inconsistent");
+            chain.norm += a;
+            chain.xlogx += MathTools::xlogx(a);
+        }
     }
 }
 
@@ -348,20 +617,14 @@ void EntropyMinimizer::addToAccumulator (SpectrumType &spectrum,
 //     Modify a spectral component in the accumulator, keeping the norm
 //-----------------------------------------------------------------------------
 
-void EntropyMinimizer::modifySpectralComponent (int keynumber,
-                                                int pitch)
+void EntropyMinimizer::modifySpectralComponent (Chain &chain, int keynumber,
+                                                int pitch) const
 {
     EptAssert(keynumber>=0 and keynumber<mNumberOfKeys,"Range of parameter key");
 
-    Key &key = mKeys[keynumber];
-    SpectrumType &spectrum = key.getSpectrum();
-    int  recorded_pitch  = getRecordedPitchET440AsInt(keynumber);
-    int    old_pitchdiff = mPitch[keynumber] - recorded_pitch;
-    int    new_pitchdiff = pitch             - recorded_pitch;
-
-    addToAccumulator(spectrum,old_pitchdiff,-1);
-    addToAccumulator(spectrum,new_pitchdiff,1);
-    mPitch[keynumber] = pitch;
+    addToAccumulator(chain,keynumber,getShift(keynumber,chain.pitch[keynumber]),-1);
+    addToAccumulator(chain,keynumber,getShift(keynumber,pitch),1);
+    chain.pitch[keynumber] = pitch;
 }
 
 
@@ -369,17 +632,119 @@ void EntropyMinimizer::modifySpectralComponent (int keynumber,
 //                          Set all spectral components
 //-----------------------------------------------------------------------------
 
-void EntropyMinimizer::setAllSpectralComponents ()
+void EntropyMinimizer::setAllSpectralComponents (Chain &chain) const
 {
-    mAccumulator.assign(NumberOfBins,0);
+    chain.accumulator.assign(mGrid->numberOfBins,0);
     for (int k=0; k<mNumberOfKeys; ++k)
+        addToAccumulator(chain,k,getShift(k,chain.pitch[k]),1);
+    resetEntropySums(chain);
+}
+
+
+//-----------------------------------------------------------------------------
+//                   Sum of the spectra of a section of keys
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the sum of the shifted spectra of a range of keys.
+///
+/// The sparse spectra of the keys are added at their current shifts, so
+/// that the effort scales with the number of nonzero entries only. The
+/// result is stored in chain.section.
+/// \param chain : Monte Carlo chain
+/// \param firstkey : Number of the first key of the section
+/// \param lastkey : Number of the last key of the section (included)
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::computeSectionSum (Chain &chain, int firstkey, int lastkey) const
+{
+    EptAssert(firstkey>=0 and firstkey<=lastkey and lastkey<mNumberOfKeys,
+              "Range of the section");
+    chain.section.assign(mGrid->numberOfBins,0);
+    for (int k=firstkey; k<=lastkey; ++k)
+        addSparseSpectrum(chain.section,k,getShift(k,chain.pitch[k]),1);
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Trial move of a section of keys
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the entropy after shifting a section of keys by one bin.
+///
+/// The accumulator of the trial is the current accumulator where the sum
+/// of the spectra in the section is replaced by the same sum shifted by one
+/// bin. The trial accumulator is kept in chain.trialAccumulator, the current
+/// accumulator and the pitches remain unchanged.
+/// \param chain : Monte Carlo chain
+/// \param firstkey : Number of the first key of the section
+/// \param lastkey : Number of the last key of the section (included)
+/// \param sign : Direction of the shift (+1 or -1)
+/// \return Entropy of the trial accumulator
+///////////////////////////////////////////////////////////////////////////////
+
+double EntropyMinimizer::computeSectionTrial (Chain &chain, int firstkey,
+                                              int lastkey, int sign) const
+{
+    computeSectionSum(chain,firstkey,lastkey);
+    const SpectrumType &section = chain.section;
+    const int bins = mGrid->numberOfBins;
+    chain.trialAccumulator.resize(bins);
+    chain.trialNorm = 0;
+    chain.trialXLogX = 0;
+    for (int m=0; m<bins; ++m)
     {
-        Key &key = mKeys[k];
-        SpectrumType spectrum = key.getSpectrum();
-        int  recorded_pitch  = getRecordedPitchET440AsInt(k);
-        int pitchdiff = mPitch[k] - recorded_pitch;
+        const double shifted = (m-sign>=0 and m-sign<bins ? section[m-sign] : 0);
+        double a = chain.accumulator[m] - section[m] + shifted;
+        // Tiny negative values are possible and will be truncated here:
+        if (a<0 and a>-1E-10) a = 0;
+        // Larger negative values will lead to an exception
+        EptAssert(a >= 0,"negative intensities are inconsistent");
+        chain.trialAccumulator[m] = a;
+        chain.trialNorm += a;
+        chain.trialXLogX += MathTools::xlogx(a);
+    }
+    EptAssert (chain.trialNorm>0,"Vectors with norm zero cannot be normalized");
+    return log(chain.trialNorm) - chain.trialXLogX / chain.trialNorm;
+}
+
 
-        addToAccumulator(spectrum,pitchdiff,1);
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Make the last section trial the current accumulator.
+///
+/// The pitches of the section have to be changed by the caller.
+/// \param chain : Monte Carlo chain
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::acceptSectionTrial (Chain &chain) const
+{
+    chain.accumulator.swap(chain.trialAccumulator);
+    chain.norm = chain.trialNorm;
+    chain.xlogx = chain.trialXLogX;
+}
+
+
+//-----------------------------------------------------------------------------
+//                   Recompute the sums over the accumulator
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Recompute chain.norm and chain.xlogx from scratch.
+///
+/// The incremental updates in addToAccumulator accumulate rounding errors.
+/// This function recomputes both sums by a full pass over the accumulator.
+/// \param chain : Monte Carlo chain
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::resetEntropySums (Chain &chain) const
+{
+    chain.norm = 0;
+    chain.xlogx = 0;
+    for (double a : chain.accumulator)
+    {
+        chain.norm += a;
+        chain.xlogx += MathTools::xlogx(a);
     }
 }
 
@@ -473,7 +838,7 @@ void EntropyMinimizer::ComputeInitialTuningCurve ()
 /// \param keynumber : Number of the key
 ///////////////////////////////////////////////////////////////////////////////
 
-int EntropyMinimizer::getTolerance (int keynumber)
+int EntropyMinimizer::getTolerance (int keynumber) const
 {
     const double toleranceA0 = 30;
     const double toleranceA2 = 15;
@@ -499,26 +864,151 @@ int EntropyMinimizer::getTolerance (int keynumber)
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Compute the entropy of the current normalized accumulator content
+///
+/// With the norm N and the sum S of x*log(x) over all entries x of the
+/// accumulator, the Shannon entropy of the normalized accumulator is given
+/// by H = log(N) - S/N. Both sums are maintained by addToAccumulator, hence
+/// the entropy is obtained in constant time.
+/// \param chain : Monte Carlo chain holding the accumulator
 /// \return Numerical value of the entropy
 ///////////////////////////////////////////////////////////////////////////////
 
-double EntropyMinimizer::computeEntropy()
+double EntropyMinimizer::computeEntropy (const Chain &chain) const
 {
-    SpectrumType copy(mAccumulator);            // get a local copy of the accumulator
-    MathTools::normalize(copy);                 // normalize it
-    return MathTools::computeEntropy(copy);     // return Shannon entropy
+    EptAssert (chain.norm>0,"Vectors with norm zero cannot be normalized");
+    return log(chain.norm) - chain.xlogx / chain.norm;
 }
 
+
 //-----------------------------------------------------------------------------
-//               Entropy minimization (the very center of the EPT)
+//                      Initialize the Monte Carlo chains
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Entropy minimizer
+/// \brief Initialize the Monte Carlo chains with the current pitches.
 ///
-/// This function is probably the most important one in the EPT. Here the
-/// Monte Carlo process is carried out in order to minize the entropy of
-/// the superposed spectra.
+/// The first chain is seeded with the seed of the user, so that a single
+/// chain reproduces the sequence of the sequential algorithm. The other
+/// chains are seeded with the user seed combined with the chain index.
+/// If the user seed is zero, all chains are seeded randomly.
+/// \param numberOfChains : Number of chains
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::initializeChains (int numberOfChains)
+{
+    // Create random device for probabilistic seeding:
+    std::random_device rd;
+    int user_seed = mParameters->getIntParameter("seed");
+
+    mChains.resize(numberOfChains);
+    for (int c=0; c<numberOfChains; ++c)
+    {
+        Chain &chain = mChains[c];
+        // Initialze Mersenne twister with random seed:
+        // - if user_seed=0 use rd
+        // - else use the seed of the user (and the chain index)
+        if (user_seed == 0) chain.generator.seed(rd());
+        else if (c == 0) chain.generator.seed(user_seed);
+        else
+        {
+            std::seed_seq seq {user_seed, c};
+            chain.generator.seed(seq);
+        }
+
+        // Define distributions to be used:
+        chain.binomial = std::binomial_distribution<int>(FLUCTUATION_WIDTH);
+        chain.keydist = std::uniform_int_distribution<int>(0,mNumberOfKeys-1);
+        chain.probdist = std::uniform_real_distribution<double>(0,1);
+
+        chain.pitch = mPitch;
+        chain.methodRatio = 1;
+        chain.acceptedTrials = 0;
+        chain.sweepKey = 0;
+        chain.sweepImprovements = 0;
+        chain.stochasticTrials = 0;
+        setAllSpectralComponents(chain);
+        chain.entropy = computeEntropy(chain);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                 Greedy optimization of the pitch of a key
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Set a key to the pitch of lowest entropy within a window.
+///
+/// The key is removed from the accumulator. For each candidate pitch within
+/// +/- GREEDY_WINDOW cents on the current grid, the change of the norm and
+/// of the sum of x*log(x) caused by adding the shifted key spectrum is
+/// computed by a pass over the sparse spectrum of the key. This gives the
+/// exact entropy of each candidate without modifying the accumulator.
+/// Finally the key is added again with the best pitch. The allowed
+/// tolerance around the initial pitch is respected in the same way as for
+/// the stochastic moves.
+/// \param chain : Monte Carlo chain
+/// \param keynumber : Number of the key
+/// \return True if the entropy was lowered
+///////////////////////////////////////////////////////////////////////////////
+
+bool EntropyMinimizer::optimizeKey (Chain &chain, int keynumber)
+{
+    const int oldpitch = chain.pitch[keynumber];
+    const int step = mGrid->binSize;
+    const double initialpitch = mInitialPitch[keynumber];
+    const double tolerance = getTolerance(keynumber);
+    const bool restricted = (fabs(oldpitch-initialpitch) < tolerance);
+
+    // remove the key from the accumulator
+    addToAccumulator(chain,keynumber,getShift(keynumber,oldpitch),-1);
+    const double norm = chain.norm;
+    const double xlogx = chain.xlogx;
+
+    int bestpitch = oldpitch;
+    double bestH = std::numeric_limits<double>::max();
+    for (int pitch=oldpitch-GREEDY_WINDOW/step*step; pitch<=oldpitch+GREEDY_WINDOW; pitch+=step)
+    {
+        if (restricted and fabs(pitch-initialpitch) > tolerance) continue;
+        const int shift = getShift(keynumber,pitch);
+        double dnorm = 0, dxlogx = 0;
+        for (const SpectralRun &run : mGrid->spectra[keynumber])
+        {
+            const int size = static_cast<int>(run.values.size());
+            const int first = std::max(0, -shift-run.first);
+            const int last  = std::min(size, mGrid->numberOfBins-shift-run.first);
+            const int offset = run.first + shift;
+            for (int i=first; i<last; ++i)
+            {
+                const double a = chain.accumulator[offset+i];
+                dnorm += run.values[i];
+                dxlogx += MathTools::xlogx(a+run.values[i]) - MathTools::xlogx(a);
+            }
+        }
+        const double H = log(norm+dnorm) - (xlogx+dxlogx) / (norm+dnorm);
+        if (H < bestH) { bestH = H; bestpitch = pitch; }
+    }
+
+    // add the key with the best pitch
+    addToAccumulator(chain,keynumber,getShift(keynumber,bestpitch),1);
+    chain.pitch[keynumber] = bestpitch;
+    double Hnew = computeEntropy(chain);
+    if (bestpitch != oldpitch and Hnew < chain.entropy)
+    {
+        chain.entropy = Hnew;
+        return true;
+    }
+    if (bestpitch != oldpitch) modifySpectralComponent(chain,keynumber,oldpitch);
+    return false;
+}
+
+
+//-----------------------------------------------------------------------------
+//                   Monte Carlo trials of a single chain
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Perform a given number of Monte Carlo trials in a single chain.
 ///
 /// We have here a so-called zero-temperature Monte Carlo algorithm. This means
 /// that a move is accepted if the entropy goes down and rejected otherwise.
@@ -528,105 +1018,402 @@ double EntropyMinimizer::computeEntropy()
 /// randomly by the same amount. These two 'methods' are stochastically mixed
 /// with a 'methodRatio' which varies slowly as time proceeds. It turns out
 /// that this greatly reduces the computation time.
+///
+/// In the greedy mode, a trial optimizes the next key of the current sweep
+/// with optimizeKey. Stochastic trials are only carried out after a sweep
+/// without improvement, in order to escape from the local minimum.
+///
+/// The function only accesses the given chain and read-only data of the
+/// minimizer, so that different chains can run in parallel.
+/// \param chain : Monte Carlo chain
+/// \param trials : Number of trials
 ///////////////////////////////////////////////////////////////////////////////
 
-void EntropyMinimizer::minimizeEntropy ()
+void EntropyMinimizer::performTrials (Chain &chain, int trials)
 {
-    int cents=20; // even number which defines the width of the fluctuations
+    const int cents = FLUCTUATION_WIDTH;
+    for (int trial=0; trial<trials and not terminateThread(); ++trial)
+    {
+        // Greedy mode: optimize the keys one after the other
+        if (mGreedy and chain.stochasticTrials == 0)
+        {
+            int keynumber = chain.sweepKey;
+            chain.sweepKey = (chain.sweepKey + 1) % mNumberOfKeys;
+            if (keynumber != mKeyNumberOfA4 and optimizeKey(chain,keynumber))
+            {
+                ++chain.acceptedTrials;
+                ++chain.sweepImprovements;
+            }
+            // a complete sweep without improvement: local minimum
+            if (chain.sweepKey == 0)
+            {
+                if (chain.sweepImprovements == 0) chain.stochasticTrials = mNumberOfKeys;
+                chain.sweepImprovements = 0;
+            }
+            continue;
+        }
+        if (chain.stochasticTrials > 0) --chain.stochasticTrials;
+
+        // Select a random key which is different from A4
+        int keynumber;
+        do keynumber = chain.keydist(chain.generator); while (keynumber==mKeyNumberOfA4);
+
+
+        if (chain.probdist(chain.generator)>chain.methodRatio)
+        // (a) Monte-Carlo step by changing the pitch of an individual key
+        {
+            int oldpitch = chain.pitch[keynumber];
+            double initialpitch =  mInitialPitch[keynumber];
+            double tolerance = getTolerance(keynumber);
+            int newpitch;
+            do newpitch = oldpitch + (chain.binomial(chain.generator)-cents/2) * mGrid->binSize;
+            while (((fabs(oldpitch-initialpitch) < tolerance and
+                     fabs(newpitch-initialpitch) > tolerance)
+                     or newpitch == oldpitch)
+                    and not terminateThread());
+            modifySpectralComponent(chain,keynumber,newpitch);
+            double Hnew = computeEntropy(chain);
+            // If new entropy is lower accept the update, otherwise restore old situation
+            if (Hnew < chain.entropy)
+            {
+                chain.entropy = Hnew;
+                ++chain.acceptedTrials;
+            }
+            else modifySpectralComponent(chain,keynumber,oldpitch);
+        }
+
+
+        else
+        // (b) perform a Monte Carlo trial in which a whole section is moved by +/- 1.
+        {
+            int sign = (chain.probdist(chain.generator)<0.5 ? 1:-1);
+            int firstkey = (keynumber < mKeyNumberOfA4 ? 0 : keynumber);
+            int lastkey = (keynumber < mKeyNumberOfA4 ? keynumber : mNumberOfKeys-1);
+            double Hnew = computeSectionTrial(chain,firstkey,lastkey,sign);
+            // If new entropy is lower accept the update, otherwise keep the old situation
+            if (Hnew < chain.entropy)
+            {
+                for (int k=firstkey; k<=lastkey; ++k) chain.pitch[k]+=sign*mGrid->binSize;
+                acceptSectionTrial(chain);
+                chain.entropy = Hnew;
+                ++chain.acceptedTrials;
+                chain.methodRatio *= 0.995;
+            }
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Run all chains in parallel
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Run the same number of trials in all chains.
+///
+/// The chains are distributed cyclically over the threads (see
+/// runInParallel). The function returns after all chains are finished.
+/// Since each chain has its own random number generator, the result does
+/// not depend on the number of threads.
+/// \param trials : Number of trials per chain
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::runChains (int trials)
+{
+    for (Chain &chain : mChains) chain.acceptedTrials = 0;
+    runInParallel(static_cast<int>(mChains.size()),
+                  [this,trials] (int thread, int numberOfThreads)
+    {
+        for (size_t c=thread; c<mChains.size(); c+=numberOfThreads)
+            performTrials(mChains[c],trials);
+    });
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Exchange states between chains
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Copy the state of the best chain to the worst chain.
+///
+/// Only the pitches and the accumulator are copied, the random number
+/// generator of the worst chain is kept. In case of equal entropies the
+/// chain with the lower index is preferred, keeping the result independent
+/// of the execution order.
+/// \return Index of the chain with the lowest entropy
+///////////////////////////////////////////////////////////////////////////////
+
+int EntropyMinimizer::exchangeChains ()
+{
+    size_t best = 0, worst = 0;
+    for (size_t c=1; c<mChains.size(); ++c)
+    {
+        if (mChains[c].entropy < mChains[best].entropy) best = c;
+        if (mChains[c].entropy >= mChains[worst].entropy) worst = c;
+    }
+    if (worst != best and mChains[worst].entropy > mChains[best].entropy)
+    {
+        const Chain &source = mChains[best];
+        Chain &target = mChains[worst];
+        target.pitch = source.pitch;
+        target.accumulator = source.accumulator;
+        target.norm = source.norm;
+        target.xlogx = source.xlogx;
+        target.entropy = source.entropy;
+        target.methodRatio = source.methodRatio;
+    }
+    return static_cast<int>(best);
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Optimization on a coarse grid
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Optimize the tuning curve on a coarse grid.
+///
+/// The spectra are downsampled to bins of binSize cents, aligned with the
+/// current pitches. Starting from mPitch, greedy sweeps over all keys are
+/// carried out until the entropy on the coarse grid does not decrease any
+/// more. The result is stored in mPitch and shown in the tuning curve.
+/// \param binSize : Number of cents per bin of the coarse grid
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::optimizeOnCoarseGrid (int binSize)
+{
+    constructGrid(mCoarseGrid,binSize);
+    mGrid = &mCoarseGrid;
+
+    Chain chain;
+    chain.pitch = mPitch;
+    setAllSpectralComponents(chain);
+    chain.entropy = computeEntropy(chain);
+    LogI("COARSE GRID (%d CENTS) ENTROPY H=%lf.",binSize,chain.entropy);
+
+    for (int sweep=0; sweep<MAXIMAL_COARSE_SWEEPS and not terminateThread(); ++sweep)
+    {
+        bool improved = false;
+        for (int k=0; k<mNumberOfKeys and not terminateThread(); ++k)
+            if (k != mKeyNumberOfA4 and optimizeKey(chain,k)) improved = true;
+        LogI("COARSE GRID (%d CENTS) ENTROPY H=%lf.",binSize,chain.entropy);
+        publishChain(chain);
+        if (not improved) break;
+    }
+    mGrid = &mFineGrid;
+}
+
+
+//-----------------------------------------------------------------------------
+//                 Estimate the remaining entropy decrease
+//-----------------------------------------------------------------------------
+
+void EntropyMinimizer::ConvergenceMonitor::clear()
+{
+    mSamples.clear();
+    mAcceptedTrials = 0;
+    mLastAcceptance = 0;
+    mGain = 0;
+    mExpectedImprovement = std::numeric_limits<double>::infinity();
+}
 
-    // Create random device for probabilistic seeding:
-    std::random_device rd;
-    int user_seed = mParameters->getIntParameter("seed");
-    // Initialze Mersenne twister with random seed:
-    // - if user_seed=0 use rd
-    // - else use the seed of the user
-    std::mt19937 generator((user_seed == 0) ? rd() : user_seed);
 
-    // Define distributions to be used:
-    std::binomial_distribution<int> binomial(cents);
-    std::uniform_int_distribution<int> keydist(0,mNumberOfKeys-1);
-    std::uniform_real_distribution<double> probdist(0,1);
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Add the state after a round of trials and update the estimate.
+///
+/// The samples of the last CONVERGENCE_WINDOW trials are kept. From these
+/// the number of accepted trials a and the decrease d of the entropy in
+/// the window are determined. The mean gain per accepted trial g=d/a is
+/// the typical size of an improvement. In the next window, a further a
+/// trials are expected to be accepted. Since a may be zero just by
+/// chance, the expected decrease of the entropy is estimated
+/// conservatively as (a+1)*g, using the last known gain if no trial was
+/// accepted in the window. If no trial was accepted for T > CONVERGENCE_WINDOW
+/// trials, the acceptance rate is bounded by 1/T and the estimate is reduced
+/// accordingly.
+/// \param trials : Number of trials carried out so far
+/// \param entropy : Current entropy
+/// \param acceptedTrials : Number of trials accepted in this round
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::ConvergenceMonitor::add (uint64_t trials, double entropy,
+                                                int acceptedTrials)
+{
+    if (mSamples.empty()) mLastAcceptance = trials;
+    else mAcceptedTrials += acceptedTrials;
+    if (acceptedTrials > 0) mLastAcceptance = trials;
+    mSamples.push_back({trials, entropy, acceptedTrials});
+    while (mSamples.size() > 1 and mSamples[1].trials + CONVERGENCE_WINDOW <= trials)
+    {
+        mAcceptedTrials -= mSamples[1].acceptedTrials;
+        mSamples.pop_front();
+    }
+
+    // the window is not complete yet
+    if (mSamples.front().trials + CONVERGENCE_WINDOW > trials) return;
+
+    const double decrease = mSamples.front().entropy - entropy;
+    if (mAcceptedTrials > 0 and decrease > 0) mGain = decrease / mAcceptedTrials;
+    const double drought = std::max<double>(CONVERGENCE_WINDOW, trials - mLastAcceptance);
+    mExpectedImprovement = (mAcceptedTrials + 1) * mGain * CONVERGENCE_WINDOW / drought;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Get the fraction of accepted trials in the last window.
+///////////////////////////////////////////////////////////////////////////////
+
+double EntropyMinimizer::ConvergenceMonitor::getAcceptanceRate() const
+{
+    if (mSamples.size() < 2) return 0;
+    return static_cast<double>(mAcceptedTrials) / (mSamples.back().trials - mSamples.front().trials);
+}
+
+
+//-----------------------------------------------------------------------------
+//               Entropy minimization (the very center of the EPT)
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Entropy minimizer
+///
+/// This function is probably the most important one in the EPT. Here the
+/// Monte Carlo process is carried out in order to minize the entropy of
+/// the superposed spectra (see performTrials).
+///
+/// With a single chain, the state is checked and displayed after every
+/// trial. With several chains, all chains perform TRIALS_PER_EXCHANGE trials
+/// in parallel, after which the best state is shared and displayed.
+///////////////////////////////////////////////////////////////////////////////
+
+void EntropyMinimizer::minimizeEntropy ()
+{
+    int numberOfChains = std::max(1, std::min(MAXIMAL_NUMBER_OF_CHAINS,
+                                              mParameters->getIntParameter("chains")));
+    const int trialsPerRound = (numberOfChains > 1 ? TRIALS_PER_EXCHANGE : 1);
+    LogI("Running %d Monte Carlo chain(s)", numberOfChains);
+
+    // minimization method
+    std::string method = mParameters->getStringParameter("method");
+    if (method != "montecarlo" and method != "greedy")
+    {
+        LogE("Method %s is not supported, using montecarlo.", method.c_str());
+    }
+    mGreedy = (method == "greedy");
 
     // copy initial condition to the actual pitch
     for (int k=0; k<mNumberOfKeys; k++)
         mPitch[k] = MathTools::roundToInteger(mInitialPitch[k]);
     updateTuningcurve();
 
-    setAllSpectralComponents();
+    // optimize on coarse grids first
+    if (mParameters->getBoolParameter("coarsetofine"))
+    {
+        optimizeOnCoarseGrid(4);
+        optimizeOnCoarseGrid(2);
+    }
+
+    constructGrid(mFineGrid,1);
+    mGrid = &mFineGrid;
+    initializeChains(numberOfChains);
 
     // compute initial entropy
-    double H = computeEntropy();
+    double H = mChains.front().entropy;
     LogI("STARTING WITH ENTROPY H=%lf.",H);
 
     // counter for calculating progress
+    // (trials are counted per chain, so that the progress does not depend
+    // on the number of chains)
     uint64_t attemptsCounter = 0;
     uint64_t updatesSinceLastChange = 0;
+    size_t pendingAcceptances = 0;
 
     // helper function for accepting an update and handling the progress bar
-    auto acceptUpdate = [&H,&updatesSinceLastChange,this] (int keynumber, double Hnew)
+    auto acceptUpdate = [&H,this] (const Chain &chain)
     {
         // update entropy and tuning curve
-        H = Hnew;
+        H = chain.entropy;
         LogI("ENTROPY H=%lf.",H);
-        if (keynumber>=0) updateTuningcurve(keynumber);
-        else updateTuningcurve();
+        publishChain(chain);
 
         // update entropy parameter
         mParameters->setDoubleParameter("entropy", H);
 
-        // 'reset' updates
-        updatesSinceLastChange /= 2;
-
         //output for testing
-        //writeAccumulator("0-accumulator.dat");
+        //writeAccumulator(chain,"0-accumulator.dat");
         //writeSpectrum(4,"tuned",mPitch[4]-getRecordedPitchET440AsInt(4));
         //writeSpectrum(16,"tuned",mPitch[16]-getRecordedPitchET440AsInt(16));
         //writeSpectrum(28,"tuned",mPitch[28]-getRecordedPitchET440AsInt(28));
     };
 
-    double methodRatio = 1;
     double lastProgress = 0;
     double pbAcc = 0;
     double pbVel = 0;
 
     // accuracy (duration) of algorithm
     int stepsToFinish = 100;
+    double tolerance = 0;
     std::string accuracy = mParameters->getStringParameter("accuracy");
     if (accuracy == "low") {stepsToFinish = 50;}
     else if (accuracy == "standard") {stepsToFinish = 100;}
     else if (accuracy == "high") {stepsToFinish = 150;}
     else if (accuracy == "infinite") {stepsToFinish = -1;}
+    else if (accuracy == "convergence") {stepsToFinish = 0; tolerance = 1E-6 * mParameters->getDoubleParameter("tolerance");}
     else {LogE("Accuracy %s is not supported, using standard.", accuracy.c_str());}
 
+    if (tolerance > 0) {LogV("Accuracy is %s, using %g as tolerance.", accuracy.c_str(), tolerance);}
+    else {LogV("Accuracy is %s, using %d as max steps.", accuracy.c_str(), stepsToFinish);}
 
-    LogV("Accuracy is %s, using %d as max steps.", accuracy.c_str(), stepsToFinish);
+    // stopping criterion based on the convergence of the entropy
+    ConvergenceMonitor convergence;
+    double initialImprovement = 0;
 
     // if infinite reset calculation progress
     if (stepsToFinish < 0) showCalculationProgress(0);
 
     // Main thread loop in which the computation is carried out
-    while (not terminateThread())
+    bool finished = false;
+    while (not finished and not terminateThread())
     {
-        ++attemptsCounter;
-        ++updatesSinceLastChange;
-
-        // update progress
-        if (stepsToFinish > 0)
+        bool resync = false;
+        for (int trial=0; trial<trialsPerRound and not finished; ++trial)
         {
-            double progress = static_cast<double>(updatesSinceLastChange) / stepsToFinish;
-            progress = std::max(progress, lastProgress);
-            pbAcc = std::max(-1.0, std::min(1.0, (progress - lastProgress)));
-            pbVel += pbAcc * 1.0;
-            pbVel = std::max(0.0, pbVel);
-            progress = pbVel * 0.001;
-            lastProgress = progress;
-            showCalculationProgress (progress);
-            if (attemptsCounter % 100 == 0) {
-                LogV("Progress: %f", progress);
+            ++attemptsCounter;
+            ++updatesSinceLastChange;
+
+            // remove rounding errors of the incremental entropy sums from time to time
+            if (attemptsCounter % 1000 == 0) resync = true;
+
+            // update progress
+            if (stepsToFinish > 0)
+            {
+                double progress = static_cast<double>(updatesSinceLastChange) / stepsToFinish;
+                progress = std::max(progress, lastProgress);
+                pbAcc = std::max(-1.0, std::min(1.0, (progress - lastProgress)));
+                pbVel += pbAcc * 1.0;
+                pbVel = std::max(0.0, pbVel);
+                progress = pbVel * 0.001;
+                lastProgress = progress;
+                showCalculationProgress (progress);
+                if (attemptsCounter % 100 == 0) {
+                    LogV("Progress: %f", progress);
+                }
+
+                // if progress larger than 1 stop the calculation
+                if (progress > 1) finished = true;
             }
+        }
+        if (finished) break;
 
-            // if progress larger than 1 stop the calculation
-            if (progress > 1) break;
+        if (resync)
+        {
+            for (Chain &chain : mChains)
+            {
+                resetEntropySums(chain);
+                chain.entropy = computeEntropy(chain);
+            }
+            H = mChains[exchangeChains()].entropy;
         }
 
         // If external manual change of tuning curve reset entropy
@@ -634,8 +1421,14 @@ void EntropyMinimizer::minimizeEntropy ()
         {
             int manualpitch = getPitchET440(mRecalculateKey,mRecalculateFrequency);
             LogI("NEW PITCH(%d) = %d.",mRecalculateKey,manualpitch);
-            modifySpectralComponent(mRecalculateKey,manualpitch);
-            H = computeEntropy();
+            for (Chain &chain : mChains)
+            {
+                modifySpectralComponent(chain,mRecalculateKey,manualpitch);
+                chain.entropy = computeEntropy(chain);
+            }
+            mPitch[mRecalculateKey] = manualpitch;
+            H = mChains[exchangeChains()].entropy;
+            convergence.clear();
             LogI("RESET ENTROPY H = %lf.",H);
             mRecalculateEntropy=false;
             mRecalculateKey=-1;
@@ -646,59 +1439,42 @@ void EntropyMinimizer::minimizeEntropy ()
         // ************** Core of the whole entropy piano tuner: **************
         // ********************************************************************
 
-        // Select a random key which is different from A4
-        int keynumber;
-        do keynumber = keydist(generator); while (keynumber==mKeyNumberOfA4);
+        runChains(trialsPerRound);
+        int acceptedTrials = 0;
+        for (const Chain &chain : mChains) acceptedTrials += chain.acceptedTrials;
 
+        // 'reset' updates, once per accepted trial of an average chain
+        pendingAcceptances += acceptedTrials;
+        for (; pendingAcceptances >= mChains.size(); pendingAcceptances -= mChains.size())
+            updatesSinceLastChange /= 2;
 
-        if (probdist(generator)>methodRatio)
-        // (a) Monte-Carlo step by changing the pitch of an individual key
-        {
-            int oldpitch = mPitch[keynumber];
-            double initialpitch =  mInitialPitch[keynumber];
-            double tolerance = getTolerance(keynumber);
-            int newpitch;
-            do newpitch = oldpitch + binomial(generator)-cents/2;
-            while (((fabs(oldpitch-initialpitch) < tolerance and
-                     fabs(newpitch-initialpitch) > tolerance)
-                     or newpitch == oldpitch)
-                    and not terminateThread());
-            modifySpectralComponent(keynumber,newpitch);
-            double Hnew = computeEntropy();
-            // If new entropy is lower accept the update, otherwise restore old situation
-            if (Hnew < H) acceptUpdate (keynumber,Hnew);
-            else modifySpectralComponent(keynumber,oldpitch);
-        }
-
+        // share the best state and display it if the entropy went down
+        const Chain &best = mChains[exchangeChains()];
+        if (best.entropy < H) acceptUpdate(best);
 
-        else
-        // (b) perform a Monte Carlo trial in which a whole section is moved by +/- 1.
+        // stop if the expected decrease of the entropy is below the tolerance
+        if (tolerance > 0)
         {
-            std::vector<int> savePitch(mPitch);
-            int sign = (probdist(generator)<0.5 ? 1:-1);
-            if (keynumber < mKeyNumberOfA4)
+            convergence.add(attemptsCounter, H, acceptedTrials);
+            const double expected = convergence.getExpectedImprovement();
+            if (expected < tolerance)
             {
-                for (int k=0; k<=keynumber; ++k) mPitch[k]+=sign;
+                LogI("Converged after %d trials, acceptance rate %f.",
+                     static_cast<int>(attemptsCounter),
+                     convergence.getAcceptanceRate() / mChains.size());
+                finished = true;
             }
-            else
+            else if (expected < std::numeric_limits<double>::infinity())
             {
-                for (int k=keynumber; k<mNumberOfKeys; ++k) mPitch[k]+=sign;
-            }
-            setAllSpectralComponents();
-            double Hnew = computeEntropy();
-            // If new entropy is lower accept the update, otherwise restore old situation
-            if (Hnew < H)
-            {
-                acceptUpdate (-1,Hnew);
-                methodRatio *= 0.995;
-            }
-            else
-            {
-                mPitch = savePitch;
-                setAllSpectralComponents();
+                // progress on a logarithmic scale between the first estimate and the tolerance
+                if (initialImprovement == 0) initialImprovement = expected;
+                double progress = log(initialImprovement / expected) / log(initialImprovement / tolerance);
+                lastProgress = std::max(lastProgress, std::min(1.0, progress));
+                showCalculationProgress(lastProgress);
             }
         }
     }
+
 #if CONFIG_ENABLE_XMGRACE
     for (int k=0; k < mNumberOfKeys; ++k) writeSpectrum(k,"middle",mPitch[k]-getRecordedPitchET440(k));
 #endif // CONFIG_ENABLE_XMGRACE
@@ -751,17 +1527,17 @@ int EntropyMinimizer::getPitchET440(int keynumber, double f)
 //			Write function for development purposes
 //-----------------------------------------------------------------------------
 
-void EntropyMinimizer::writeAccumulator(std::string filename)
+void EntropyMinimizer::writeAccumulator(const Chain &chain, std::string filename)
 {
 #if CONFIG_ENABLE_XMGRACE
     std::ofstream os (filename);
     for (int m=0; m<NumberOfBins; ++m)
     {
-        os << Key::IndexToFrequency(m) << "\t" << mAccumulator[m] << std::endl;
+        os << Key::IndexToFrequency(m) << "\t" << chain.accumulator[m] << std::endl;
     }
     os.close();
 #else
-    (void)filename; // suppress warnings
+    (void)chain; (void)filename; // suppress warnings
 #endif // CONFIG_ENABLE_XMGRACE
 }
 
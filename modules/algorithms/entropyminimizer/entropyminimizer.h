@@ -24,6 +24,13 @@
 #ifndef ENTROPYMINIMIZER_H
 #define ENTROPYMINIMIZER_H
 
+#include <random>
+#include <functional>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <exception>
+
 #include "core/calculation/algorithmplugin.h"
 
 /// Namespace for all entropy minimizer components
@@ -40,11 +47,62 @@ ALGORITHM_H_START(entropyminimizer)
 /// computing the sum of all spectra after each Monte Carlo step again, we
 /// simply subtract the previous and add the new spectrum of the modified
 /// key alone.
+///
+/// In the same spirit, the sum of the accumulator entries and the sum
+/// of x*log(x) over all entries are kept up to date. Since the entropy of the
+/// normalized accumulator can be expressed in terms of these two sums, it
+/// is available without any further pass over the accumulator.
+///
+/// After preprocessing, the spectra are mostly zero apart from the
+/// mollified peaks of the partials. The minimizer therefore keeps a sparse
+/// copy of each spectrum, consisting of runs of contiguous non-vanishing
+/// bins, from which the accumulator is updated.
+///
+/// For moves of a whole section of keys, the sparse spectra of the section
+/// are summed up at their current shifts. The accumulator of a section move
+/// is then computed in a single pass over the bins.
+///
+/// The Monte Carlo process can be carried out by several independent chains
+/// in parallel (parameter "chains"). Each chain owns its accumulator and
+/// its random number generator. After a fixed number of trials the chains
+/// are synchronized, the state of the best chain is copied to the worst
+/// one and the best state is shown in the tuning curve. Since the chains
+/// only interact at these synchronization points, the result is
+/// deterministic for a given seed and number of chains.
+///
+/// Alternatively to the random selection of keys, the minimization can be
+/// carried out as a greedy coordinate descent (parameter "method"). Here
+/// the keys are visited one after the other and for each key the entropy
+/// of all pitches within a window of +/- GREEDY_WINDOW cents is evaluated
+/// in a single pass over the spectrum of that key. The best pitch is taken.
+/// Only if a complete sweep over the keyboard does not lower the entropy,
+/// a number of stochastic trials is carried out to escape from the local
+/// minimum.
+///
+/// Since the initial tuning curve may be off by many cents, the
+/// minimization can start on coarser grids (parameter "coarsetofine").
+/// Here the spectra are downsampled to 4-cent and 2-cent bins and the
+/// tuning curve is optimized by greedy sweeps in steps of 4 and 2 cents,
+/// before the actual minimization at full resolution starts.
+///
+/// With the accuracy "convergence" the minimization does not stop after a
+/// fixed number of unsuccessful steps. Instead, the ConvergenceMonitor
+/// estimates the further decrease of the entropy from the acceptance rate
+/// and the mean gain per accepted trial in a sliding window, and the
+/// minimization stops when this estimate drops below the tolerance.
 ///////////////////////////////////////////////////////////////////////////////
 
 
 class EntropyMinimizer : public Algorithm, public MessageListener
 {
+public:
+    static const int FLUCTUATION_WIDTH = 20;        ///< Even number defining the width of the pitch fluctuations
+    static const int TRIALS_PER_EXCHANGE = 200;     ///< Trials of each chain between two synchronizations
+    static const int MAXIMAL_NUMBER_OF_CHAINS = 16; ///< Upper bound for the number of parallel chains (about 8 MB each)
+    static const int GREEDY_WINDOW = 20;            ///< Range of pitches in cents scanned by a greedy step
+    static const int MAXIMAL_COARSE_SWEEPS = 20;    ///< Maximal number of greedy sweeps on a coarse grid
+    static const int CONVERGENCE_WINDOW = 2000;     ///< Trials per window of the convergence estimate
+
 public:
     EntropyMinimizer(const Piano &piano, const AlgorithmFactoryDescription &desciption);
     ~EntropyMinimizer(){};
@@ -56,11 +114,57 @@ protected:
 private:
     bool performAuditoryPreprocessing();
 
+    /// Function processing a single key, using a buffer of the calling thread
+    using KeyProcessor = std::function<void(Key &key, Key::SpectrumType &buffer)>;
+    bool processKeysInParallel (const KeyProcessor &process, double start, double range);
+
     void ComputeInitialTuningCurve ();
     void minimizeEntropy ();
 
     using SpectrumType = Key::SpectrumType;
     using Keys = Keyboard::Keys;
+
+    /// Run of contiguous non-vanishing bins of a spectrum
+    struct SpectralRun
+    {
+        int first;                      ///< Index of the first bin of the run
+        std::vector<double> values;     ///< Values of the contiguous bins
+    };
+    using SparseSpectrum = std::vector<SpectralRun>;
+
+    /// Sparse spectra of all keys on a grid of given resolution
+    struct Grid
+    {
+        int binSize = 1;                        ///< Number of cents per bin
+        int numberOfBins = 0;                   ///< Number of bins
+        std::vector<SparseSpectrum> spectra;    ///< Sparse spectra of all keys
+        std::vector<int> referencePitch;        ///< Pitch at which a spectrum is not shifted
+    };
+
+    /// State and workspace of a single Monte Carlo chain
+    struct Chain
+    {
+        std::vector<int> pitch;                 ///< Pitches of all keys (in cents)
+        SpectrumType accumulator;               ///< Sum of the shifted spectra of all keys
+        double norm = 0;                        ///< Sum of all entries of the accumulator
+        double xlogx = 0;                       ///< Sum of x*log(x) over the accumulator
+        double entropy = 0;                     ///< Entropy of the normalized accumulator
+        double methodRatio = 1;                 ///< Probability for moving a whole section
+        int acceptedTrials = 0;                 ///< Accepted trials since the last synchronization
+        int sweepKey = 0;                       ///< Next key of the greedy sweep
+        int sweepImprovements = 0;              ///< Improvements within the current greedy sweep
+        int stochasticTrials = 0;               ///< Remaining stochastic trials before sweeping again
+
+        SpectrumType section;                   ///< Sum of the spectra of a section of keys
+        SpectrumType trialAccumulator;          ///< Accumulator of a section trial
+        double trialNorm = 0;                   ///< Sum of all entries of trialAccumulator
+        double trialXLogX = 0;                  ///< Sum of x*log(x) over trialAccumulator
+
+        std::mt19937 generator;                             ///< Random number generator of the chain
+        std::binomial_distribution<int> binomial;           ///< Distribution of the pitch changes
+        std::uniform_int_distribution<int> keydist;         ///< Distribution of the selected keys
+        std::uniform_real_distribution<double> probdist;    ///< Uniform distribution in [0,1)
+    };
     const int NumberOfBins = Key::NumberOfBins;
 
 
@@ -73,19 +177,84 @@ private:
 
     void updateTuningcurve (int keynumber);
     void updateTuningcurve ();
+    void publishChain (const Chain &chain);
     void clear();
     double getElement(SpectrumType &spectrum, int m);
-    void addToAccumulator (SpectrumType &spectrum, int shift, double intensity);
-    void modifySpectralComponent (int key, int pitch);
-    void setAllSpectralComponents();
+    void constructGrid (Grid &grid, int binSize);
+    int  getShift (int keynumber, int pitch) const;
+    void addSparseSpectrum (SpectrumType &target, int keynumber, int shift, double intensity) const;
+    void addToAccumulator (Chain &chain, int keynumber, int shift, double intensity) const;
+    void computeSectionSum (Chain &chain, int firstkey, int lastkey) const;
+    double computeSectionTrial (Chain &chain, int firstkey, int lastkey, int sign) const;
+    void acceptSectionTrial (Chain &chain) const;
+    void modifySpectralComponent (Chain &chain, int key, int pitch) const;
+    void setAllSpectralComponents (Chain &chain) const;
     void addReferenceSpectrum (double intensity);
-    int  getTolerance (int keynumber);
+    int  getTolerance (int keynumber) const;
+
+    void resetEntropySums (Chain &chain) const;
+    double computeEntropy (const Chain &chain) const;
+
+    void initializeChains (int numberOfChains);
+    bool optimizeKey (Chain &chain, int keynumber);
+    void performTrials (Chain &chain, int trials);
+    void runChains (int trials);
+    void optimizeOnCoarseGrid (int binSize);
+    int  exchangeChains ();
+
+    /// Persistent worker thread executing tasks of the minimizer
+    class Worker : public SimpleThreadHandler
+    {
+    public:
+        Worker () : SimpleThreadHandler(true) {}
+        ~Worker() { waitForCompletion(); }
+
+        void run (std::function<void()> task);
+        std::exception_ptr finish();
+
+    private:
+        void workerFunction() override final;
+
+        std::function<void()> mTask;    ///< The task of the current job
+        std::exception_ptr mException;  ///< Exception thrown by the current task
+    };
+
+    /// Task executed by the thread with the given index out of a number of threads
+    using ParallelTask = std::function<void(int thread, int numberOfThreads)>;
+    void runInParallel (int maximalNumberOfThreads, const ParallelTask &task);
+
+    /// Sliding-window estimate of the remaining decrease of the entropy
+    class ConvergenceMonitor
+    {
+    public:
+        void clear();
+        void add (uint64_t trials, double entropy, int acceptedTrials);
+        double getExpectedImprovement() const { return mExpectedImprovement; }
+        double getAcceptanceRate() const;
 
-    double computeEntropy();
+    private:
+        /// Entropy and number of accepted trials after a round of trials
+        struct Sample
+        {
+            uint64_t trials;            ///< Number of trials carried out so far
+            double entropy;             ///< Entropy after these trials
+            int acceptedTrials;         ///< Trials accepted in the last round
+        };
+        std::deque<Sample> mSamples;    ///< Samples of the last window
+        int mAcceptedTrials = 0;        ///< Trials accepted in the last window
+        uint64_t mLastAcceptance = 0;   ///< Number of trials at the last acceptance
+        double mGain = 0;               ///< Mean decrease of the entropy per accepted trial
+        double mExpectedImprovement = std::numeric_limits<double>::infinity();   ///< Current estimate
+    };
 
 private:
-    SpectrumType mAccumulator;          ///< Accumulator holding the sum of all spectra
-    std::vector<int> mPitch;            ///< Vector of pitches (in cents)
+    Grid mFineGrid;                             ///< Sparse spectra at full resolution
+    Grid mCoarseGrid;                           ///< Sparse spectra on a coarse grid
+    const Grid *mGrid;                          ///< Grid currently used for the minimization
+    std::vector<Chain> mChains;                 ///< Monte Carlo chains
+    std::vector<std::unique_ptr<Worker>> mWorkers;  ///< Persistent workers for parallel tasks
+    bool mGreedy;                               ///< Flag for the greedy coordinate descent
+    std::vector<int> mPitch;            ///< Vector of displayed pitches (in cents)
     std::vector<double>mInitialPitch;   ///< Vector of initial pitches
     int mLowerCutoff;                   ///< Lower cutoff for fluctuations
     int mUpperCutoff;                   ///< Upper cutoff for fluctuations
@@ -99,7 +268,7 @@ private:
 
 protected:
     // only for development:
-    void writeAccumulator(std::string filename);
+    void writeAccumulator(const Chain &chain, std::string filename);
     void writeSpectrum(int k, std::string filename, int pitch=0);
 };
 
@@ -3,5 +3,5 @@ include(../algorithms_func.pri)
 $$declareAlgorithm(entropyminimizer, 1.0.0)
 
 # additional files
-SOURCES += auditorypreprocessing.cpp
-HEADERS += auditorypreprocessing.h
+SOURCES += auditorypreprocessing.cpp preprocessingcache.cpp
+HEADERS += auditorypreprocessing.h preprocessingcache.h
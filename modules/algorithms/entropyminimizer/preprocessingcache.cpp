@@ -0,0 +1,267 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                     Cache of preprocessed spectra
+//=============================================================================
+
+#include "preprocessingcache.h"
+
+#include <fstream>
+
+#include "core/system/eptexception.h"
+#include "core/system/log.h"
+#include "core/adapters/filemanager.h"
+
+namespace entropyminimizer
+{
+
+const uint32_t PreprocessingCache::FORMAT_VERSION = 1;
+const size_t PreprocessingCache::MAXIMAL_NUMBER_OF_ENTRIES = 2;
+const std::string PreprocessingCache::CACHE_FILE_NAME = "entropyminimizer-spectra.cache";
+
+std::mutex PreprocessingCache::mMutex;
+std::list<PreprocessingCache::EntryPtr> PreprocessingCache::mEntries;
+
+
+//-----------------------------------------------------------------------------
+//                      Compute the hash of the piano
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the hash identifying the recorded data of a piano.
+///
+/// The hash is a 64-bit FNV-1a hash over the size of the keyboard, the
+/// format version and the recorded data of all keys which enter the
+/// preprocessing.
+/// \param piano : Piano before preprocessing
+/// \return Hash value
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t PreprocessingCache::computeHash (const Piano &piano)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash] (const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        for (size_t i=0; i<size; ++i) hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    };
+    auto addValue = [&add] (double value) { add(&value, sizeof(value)); };
+
+    const Keyboard &keyboard = piano.getKeyboard();
+    addValue(FORMAT_VERSION);
+    addValue(keyboard.getNumberOfKeys());
+    addValue(keyboard.getKeyNumberOfA4());
+    for (int k=0; k<keyboard.getNumberOfKeys(); ++k)
+    {
+        const Key &key = keyboard[k];
+        addValue(key.isRecorded());
+        addValue(key.getRecordedFrequency());
+        addValue(key.getMeasuredInharmonicity());
+        const Key::SpectrumType &spectrum = key.getSpectrum();
+        addValue(static_cast<double>(spectrum.size()));
+        add(spectrum.data(), spectrum.size() * sizeof(double));
+        for (const auto &peak : key.getPeaks())
+        {
+            addValue(peak.first);
+            addValue(peak.second);
+        }
+    }
+    return hash;
+}
+
+
+//-----------------------------------------------------------------------------
+//                       Restore the preprocessed data
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Restore the preprocessed spectra of a piano from the cache.
+///
+/// If an entry with the given hash is found in memory (or in the cache
+/// file, if enabled), the spectra and inharmonicities of the keys are
+/// replaced by the cached values.
+/// \param hash : Hash of the piano computed before preprocessing
+/// \param piano : Piano whose keys are replaced
+/// \param useFile : Look up the cache file if the entry is not in memory
+/// \return true if the data was found in the cache
+///////////////////////////////////////////////////////////////////////////////
+
+bool PreprocessingCache::restore (uint64_t hash, Piano &piano, bool useFile)
+{
+    EntryPtr entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) if ((*it)->hash == hash)
+        {
+            entry = *it;
+            mEntries.erase(it);
+            mEntries.push_front(entry);
+            break;
+        }
+    }
+    if (not entry and useFile)
+    {
+        entry = readFile(hash);
+        if (not entry) return false;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEntries.push_front(entry);
+        if (mEntries.size() > MAXIMAL_NUMBER_OF_ENTRIES) mEntries.pop_back();
+    }
+    if (not entry) return false;
+
+    Keyboard::Keys &keys = piano.getKeyboard().getKeys();
+    if (entry->spectra.size() != keys.size()) return false;
+    for (size_t k=0; k<keys.size(); ++k)
+    {
+        keys[k].getSpectrum() = entry->spectra[k];
+        keys[k].setMeasuredInharmonicity(entry->inharmonicities[k]);
+    }
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Store the preprocessed data
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Store the preprocessed spectra of a piano in the cache.
+/// \param hash : Hash of the piano computed before preprocessing
+/// \param piano : Piano after preprocessing
+/// \param useFile : Write the entry to the cache file as well
+///////////////////////////////////////////////////////////////////////////////
+
+void PreprocessingCache::store (uint64_t hash, const Piano &piano, bool useFile)
+{
+    auto entry = std::make_shared<Entry>();
+    entry->hash = hash;
+    const Keyboard &keyboard = piano.getKeyboard();
+    for (int k=0; k<keyboard.getNumberOfKeys(); ++k)
+    {
+        entry->spectra.push_back(keyboard[k].getSpectrum());
+        entry->inharmonicities.push_back(keyboard[k].getMeasuredInharmonicity());
+    }
+    if (useFile) writeFile(*entry);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) if ((*it)->hash == hash)
+    {
+        mEntries.erase(it);
+        break;
+    }
+    mEntries.push_front(entry);
+    if (mEntries.size() > MAXIMAL_NUMBER_OF_ENTRIES) mEntries.pop_back();
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Clear the memory cache
+//-----------------------------------------------------------------------------
+
+void PreprocessingCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+//                          Read the cache file
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Read the cache file.
+///
+/// The file consists of the format version, the hash, the number of keys
+/// and the number of bins, followed by the inharmonicity and the spectrum
+/// of each key in binary form.
+/// \param hash : Requested hash
+/// \return Pointer to the entry, nullptr if not available
+///////////////////////////////////////////////////////////////////////////////
+
+PreprocessingCache::EntryPtr PreprocessingCache::readFile (uint64_t hash)
+{
+    const std::string filename = FileManager::getSingleton().getCacheFilePath(CACHE_FILE_NAME);
+
+    std::ifstream stream(filename, std::ios::binary);
+    if (not stream) return nullptr;
+
+    uint32_t version = 0;
+    uint64_t filehash = 0;
+    int32_t numberOfKeys = 0, numberOfBins = 0;
+    stream.read(reinterpret_cast<char*>(&version), sizeof(version));
+    stream.read(reinterpret_cast<char*>(&filehash), sizeof(filehash));
+    stream.read(reinterpret_cast<char*>(&numberOfKeys), sizeof(numberOfKeys));
+    stream.read(reinterpret_cast<char*>(&numberOfBins), sizeof(numberOfBins));
+    if (not stream or version != FORMAT_VERSION or filehash != hash) return nullptr;
+    if (numberOfKeys <= 0 or numberOfKeys > 1000 or numberOfBins != Key::NumberOfBins) return nullptr;
+
+    auto entry = std::make_shared<Entry>();
+    entry->hash = hash;
+    entry->spectra.resize(numberOfKeys, Key::SpectrumType(numberOfBins));
+    entry->inharmonicities.resize(numberOfKeys);
+    for (int k=0; k<numberOfKeys; ++k)
+    {
+        stream.read(reinterpret_cast<char*>(&entry->inharmonicities[k]), sizeof(double));
+        stream.read(reinterpret_cast<char*>(entry->spectra[k].data()), numberOfBins * sizeof(double));
+    }
+    if (not stream)
+    {
+        LogW("Cache file %s is corrupt", filename.c_str());
+        return nullptr;
+    }
+    LogI("Preprocessed spectra loaded from %s", filename.c_str());
+    return entry;
+}
+
+
+//-----------------------------------------------------------------------------
+//                          Write the cache file
+//-----------------------------------------------------------------------------
+
+void PreprocessingCache::writeFile (const Entry &entry)
+{
+    const std::string filename = FileManager::getSingleton().getCacheFilePath(CACHE_FILE_NAME);
+
+    std::ofstream stream(filename, std::ios::binary | std::ios::trunc);
+    if (not stream)
+    {
+        LogW("Cache file %s could not be opened", filename.c_str());
+        return;
+    }
+    const uint32_t version = FORMAT_VERSION;
+    const int32_t numberOfKeys = static_cast<int32_t>(entry.spectra.size());
+    const int32_t numberOfBins = Key::NumberOfBins;
+    stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    stream.write(reinterpret_cast<const char*>(&entry.hash), sizeof(entry.hash));
+    stream.write(reinterpret_cast<const char*>(&numberOfKeys), sizeof(numberOfKeys));
+    stream.write(reinterpret_cast<const char*>(&numberOfBins), sizeof(numberOfBins));
+    for (size_t k=0; k<entry.spectra.size(); ++k)
+    {
+        EptAssert(entry.spectra[k].size() == static_cast<size_t>(numberOfBins), "Wrong spectrum size");
+        stream.write(reinterpret_cast<const char*>(&entry.inharmonicities[k]), sizeof(double));
+        stream.write(reinterpret_cast<const char*>(entry.spectra[k].data()), numberOfBins * sizeof(double));
+    }
+    if (not stream) LogW("Cache file %s could not be written", filename.c_str());
+}
+
+
+//-----------------------------------------------------------------------------
+}  // namespace entropyminimizer
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                     Cache of preprocessed spectra
+//=============================================================================
+
+#ifndef PREPROCESSINGCACHE_H
+#define PREPROCESSINGCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/piano/piano.h"
+
+namespace entropyminimizer
+{
+
+////////////////////////////////////////////////////////////////////////
+/// \brief Cache of the spectra after auditory preprocessing
+///
+/// If the calculation is restarted with different settings of the
+/// algorithm (seed, accuracy, ...) the auditory preprocessing would
+/// produce exactly the same spectra again. The results are therefore
+/// cached, identified by a hash over the recorded data of all keys
+/// (spectra, frequencies, inharmonicities, peaks) and the size of the
+/// keyboard. The whole keyboard forms a single entry since some of the
+/// preprocessing steps involve several keys.
+///
+/// The cache lives in memory and holds the most recent entries. The
+/// most recent entry can in addition be written to a file in the cache
+/// directory of the platform, so that it survives a restart of the
+/// application. FORMAT_VERSION has to be increased whenever the
+/// preprocessing or the file format is changed.
+////////////////////////////////////////////////////////////////////////
+
+class PreprocessingCache
+{
+public:
+    static const uint32_t FORMAT_VERSION;               ///< Version of the preprocessing and the file
+    static const size_t MAXIMAL_NUMBER_OF_ENTRIES;      ///< Number of pianos held in memory
+    static const std::string CACHE_FILE_NAME;           ///< Name of the cache file
+
+    static uint64_t computeHash (const Piano &piano);
+    static bool restore (uint64_t hash, Piano &piano, bool useFile);
+    static void store (uint64_t hash, const Piano &piano, bool useFile);
+    static void clear();
+
+private:
+    /// Preprocessed data of a complete keyboard
+    struct Entry
+    {
+        uint64_t hash = 0;                              ///< Hash of the recorded data
+        std::vector<Key::SpectrumType> spectra;         ///< Preprocessed spectra
+        std::vector<double> inharmonicities;            ///< Extrapolated inharmonicities
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    static EntryPtr readFile (uint64_t hash);
+    static void writeFile (const Entry &entry);
+
+    static std::mutex mMutex;                           ///< Mutex protecting the entries
+    static std::list<EntryPtr> mEntries;                ///< Cached entries, most recent first
+};
+
+}  // namespace entropyminimizer
+
+#endif // PREPROCESSINGCACHE_H
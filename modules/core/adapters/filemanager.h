@@ -73,6 +73,19 @@ public:
 
     virtual std::string getLogFilePath(const std::string &logname) const = 0;
 
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Abstract function: Get the standard path for cache files
+    ///
+    /// Cache files hold data which can be recomputed at any time but
+    /// which is expensive to compute, for example the FFTW wisdom. Each
+    /// platform provides a different standard directory for such files.
+    /// \see FileManagerForQt
+    /// \param filename : The name of the cache file
+    /// \returns Absolute path to the cache file
+    ///////////////////////////////////////////////////////////////////////////
+
+    virtual std::string getCacheFilePath(const std::string &filename) const = 0;
+
     ///////////////////////////////////////////////////////////////////////////
     /// \brief Abstract function: Get the file content for an algorithm
     ///
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <algorithm>
 #include <utility>
+#include <cstring>
 
 #include "../config.h"
 #include "../system/log.h"
@@ -34,13 +35,17 @@
 #include "../math/mathtools.h"
 
 
+constexpr int FFTAnalyzer::NumberOfBins;
+
 //-----------------------------------------------------------------------------
 //                                Constructor
 //-----------------------------------------------------------------------------
 
 FFTAnalyzer::FFTAnalyzer() :
     mOptimalSuperposition(),            // Array for peak superposition
-    mCurrentKernelKey(nullptr)          // Initially no kernel
+    mKernelFFT(),                       // Initially no kernel
+    mKernelKeyNumber(-1),
+    mKernelStamp(0)
 {}
 
 //-----------------------------------------------------------------------------
@@ -243,17 +248,103 @@ FrequencyDetectionResult FFTAnalyzer::detectFrequencyOfKnownKey (
     {
 
 
-        // create the kernel of the key, if the key changed
-        if (&key != mCurrentKernelKey)
+        // create the kernel of the key, if the key or its spectrum changed.
+        // The key is passed as a copy, hence its address cannot be used.
+        const uint64_t stamp = computeStamp(key.getSpectrum());
+        if (keyIndex != mKernelKeyNumber or stamp != mKernelStamp or mKernelFFT.empty())
         {
-            mCurrentKernel = constructKernel(key.getSpectrum());
-            mCurrentKernelKey = &key;
+            constructKernel(key.getSpectrum());
+            mKernelKeyNumber = keyIndex;
+            mKernelStamp = stamp;
         }
 
         // compute the deviation
-        out = computeTuningDeviation(mCurrentKernel, spectrum, searchSize);
+        out = computeTuningDeviation(spectrum, searchSize);
     }
 
+    evaluateTuningDeviation(out, centerFrequency, targetFrequency, result);
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+//        Determine the frequency of a known key by a zoom analysis
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Determine the frequency of a known key from the time signal
+///
+/// Instead of the full spectrum, this function analyzes only the narrow
+/// bands around the first partials of the key (see ZoomAnalyzer). The
+/// partials are located according to the measured inharmonicity of the key
+/// or, if the key has not been recorded, the expected one.
+/// \param signal : Preprocessed audio signal
+/// \param samplingRate : Sampling rate of the signal
+/// \param piano : Pointer to the piano
+/// \param key : Copy of the selected key
+/// \param keyIndex : Index of the selected key
+/// \return Result of the frequency detection
+///////////////////////////////////////////////////////////////////////////////
+
+FrequencyDetectionResult FFTAnalyzer::detectFrequencyOfKnownKey (
+        const FFTWVector &signal,
+        int samplingRate,
+        const Piano *piano,
+        const Key &key,
+        int keyIndex)
+{
+    EptAssert(piano, "Piano has to be set");
+    EptAssert(samplingRate > 0, "Sampling rate has to be positive");
+    EptAssert(keyIndex >= 0, "The final key has to be set.");
+
+    FrequencyDetectionResult result = std::make_shared<FrequencyDetectionResultStruct>();
+
+    double targetFrequency = piano->getConcertPitch()/440.0 *
+                             key.getComputedFrequency();
+    if (targetFrequency <= 20 or targetFrequency > 10000)
+    {
+        result->error = FFTAnalyzerErrorTypes::ERR_NO_COMPUTED_FREQUENCY;
+        return result;
+    }
+
+    double centerFrequency = key.getRecordedFrequency();
+    if (centerFrequency<=10) centerFrequency = targetFrequency;
+
+    double B = key.getMeasuredInharmonicity();
+    if (B <= 0) B = piano->getExpectedInharmonicity(centerFrequency);
+
+    const int searchSize = 200;
+    TuningDeviationCurveType out(searchSize);
+    if (not mZoomAnalyzer.computeTuningDeviation(signal, samplingRate, centerFrequency, B, out))
+    {
+        result->error = FFTAnalyzerErrorTypes::ERR_NO_PEAK_AMPLITUDE;
+        return result;
+    }
+
+    evaluateTuningDeviation(out, centerFrequency, targetFrequency, result);
+    return result;
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Evaluate the tuning deviation curve
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Locate the maximum of the tuning deviation curve and fill the
+/// result of the frequency detection
+/// \param out : Tuning deviation curve, moved into the result
+/// \param centerFrequency : Frequency corresponding to the middle of the curve
+/// \param targetFrequency : Frequency to which the key shall be tuned
+/// \param result : Result of the frequency detection
+///////////////////////////////////////////////////////////////////////////////
+
+void FFTAnalyzer::evaluateTuningDeviation (TuningDeviationCurveType &out,
+                                           double centerFrequency,
+                                           double targetFrequency,
+                                           FrequencyDetectionResult result)
+{
+    const int searchSize = static_cast<int>(out.size());
     int maxIndex = MathTools::findMaximum(out);
     double index = MathTools::weightedArithmetricMean(out, std::max(maxIndex - 10, 0), maxIndex + 10);
     index -= searchSize / 2;
@@ -270,8 +361,6 @@ FrequencyDetectionResult FFTAnalyzer::detectFrequencyOfKnownKey (
     result->tuningDeviationCurve = std::move(out);
 
     LogV("Deviation %d, comp index %d", result->deviationInCents, computedIndex);
-
-    return result;
 }
 
 //-----------------------------------------------------------------------------
@@ -288,6 +377,8 @@ FrequencyDetectionResult FFTAnalyzer::detectFrequencyOfKnownKey (
 /// transforms the incoming FFT into a logarithmically binned spectrum.
 /// The dimension NumberOfBins is copied from the constant in class Key.
 /// The actual map between the indices can be found in Key::IndexToFrequency.
+/// The binning plan is only recomputed if the size of the FFT or the
+/// sampling rate changes.
 ///
 /// \param fftData Data of the fourier transform
 /// \param spectrum Vector holding the logarithmically binned spectrum.
@@ -295,37 +386,100 @@ FrequencyDetectionResult FFTAnalyzer::detectFrequencyOfKnownKey (
 
 void FFTAnalyzer::constructLogBinnedSpectrum(FFTDataPointer fftData, SpectrumType &spectrum)
 {
-    const double b = 2.0 * fftData->fft.size() / fftData->samplingRate;
-    std::function<double(double)> mtoq = [b] (double m)
-             { return b * Key::IndexToFrequency(m); };
-    MathTools::coarseGrainSpectrum (fftData->fft,spectrum,mtoq,0.25);
+    if (not mLogBinning.isValid(fftData->fft.size(), fftData->samplingRate, NumberOfBins))
+    {
+        const double b = 2.0 * fftData->fft.size() / fftData->samplingRate;
+        std::function<double(double)> mtoq = [b] (double m)
+                 { return b * Key::IndexToFrequency(m); };
+        mLogBinning.create(fftData->fft.size(), fftData->samplingRate, NumberOfBins, mtoq, 0.25);
+    }
+    mLogBinning.apply(fftData->fft, spectrum);
     MathTools::normalize(spectrum);
 }
 
-FFTAnalyzer::SpectrumType FFTAnalyzer::constructKernel(const SpectrumType &originalSpectrum)
+//-----------------------------------------------------------------------------
+//                    Kernel for the inverse convolution
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Construct the Fourier transform of the kernel.
+///
+/// The kernel is the inverse of the recorded spectrum of the key with
+/// respect to the circular convolution. Its Fourier transform is simply
+/// 1/F where F is the Fourier transform of the recorded spectrum. Only this
+/// transform is stored since the correlation is computed in Fourier space.
+///
+/// \param originalSpectrum : Recorded log-binned spectrum of the key
+///////////////////////////////////////////////////////////////////////////////
+
+void FFTAnalyzer::constructKernel(const SpectrumType &originalSpectrum)
+{
+    // the FFT operates on FFTRealType which may be single precision
+    mSignal.assign(originalSpectrum.begin(), originalSpectrum.end());
+    mFFT.calculateFFT(mSignal, mKernelFFT);
+    for (FFTComplexType &c : mKernelFFT) {
+        c = std::conj(c) / (c.real() * c.real() + c.imag() * c.imag());
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute a stamp identifying the content of a spectrum.
+///
+/// The stamp is a 64-bit FNV-1a hash of the spectrum. It is used to detect
+/// changes of the recorded spectrum of a key, e.g. after re-recording.
+/// \param spectrum : Log-binned spectrum
+/// \return Hash value
+///////////////////////////////////////////////////////////////////////////////
+
+uint64_t FFTAnalyzer::computeStamp(const SpectrumType &spectrum)
 {
-    SpectrumType kernel(NumberOfBins);
-    FFTComplexVector fftOfOriginal;
-    mFFT.calculateFFT(originalSpectrum, fftOfOriginal);
-    for (FFTComplexType &c : fftOfOriginal) {
-        c = c / (c.real() * c.real() + c.imag() * c.imag());
+    uint64_t hash = 14695981039346656037ULL;
+    for (const double value : spectrum)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ULL;
     }
-    mFFT.calculateFFT(fftOfOriginal, kernel);
-    return kernel;
+    return hash;
 }
 
+
+//-----------------------------------------------------------------------------
+//                      Compute the tuning deviation
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Correlate the kernel with the signal in the search window.
+///
+/// The circular correlation of the kernel k with the signal s,
+/// out[j] = sum_i k[i-j] s[i], is computed in Fourier space as the
+/// backward transform of S/F, where S is the transform of the signal
+/// and 1/F the stored transform of the kernel. This requires one forward
+/// and one backward FFT instead of searchSize * NumberOfBins operations.
+///
+/// \param signal : Log-binned spectrum of the current signal
+/// \param searchSize : Size of the search window in cents
+/// \return Correlation in the window centered at zero shift
+///////////////////////////////////////////////////////////////////////////////
+
 TuningDeviationCurveType FFTAnalyzer::computeTuningDeviation(
-        const SpectrumType &kernel, const SpectrumType &signal, int searchSize)
+        const SpectrumType &signal, int searchSize)
 {
+    EptAssert(signal.size() == static_cast<size_t>(NumberOfBins) and
+              mKernelFFT.size() == static_cast<size_t>(NumberOfBins/2+1),
+              "Kernel and signal have to be log-binned spectra");
     const int searchOffset = searchSize / 2;
     TuningDeviationCurveType out(searchSize);
 
+    mSignal.assign(signal.begin(), signal.end());
+    mFFT.calculateFFT(mSignal, mSignalFFT);
+    for (int k = 0; k <= NumberOfBins/2; ++k) mSignalFFT[k] *= mKernelFFT[k];
+    mFFT.calculateFFT(mSignalFFT, mCorrelation);
+
     // in a range of 50 ct find the maximum when folding the kernel with the spectrum
     for (int j = -searchOffset; j < searchSize - searchOffset; j++) {
-        out[j + searchOffset] = 0;
-        for (int i = 0; i < NumberOfBins; i++) {
-            out[j + searchOffset] += kernel[(i - j + NumberOfBins) % NumberOfBins] * signal[i];
-        }
+        out[j + searchOffset] = mCorrelation[(j + NumberOfBins) % NumberOfBins];
     }
 
     return out;
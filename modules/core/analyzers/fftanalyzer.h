@@ -29,6 +29,8 @@
 #include "../piano/piano.h"
 #include "../math/fftadapter.h"
 #include "../math/fftimplementation.h"
+#include "../math/logbinningplan.h"
+#include "zoomanalyzer.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Module performing the final analysis of the Fourier transform
@@ -59,20 +61,36 @@ public:
             const Key &key,
             int keyIndex);
 
+    FrequencyDetectionResult detectFrequencyOfKnownKey(
+            const FFTWVector &signal,
+            int samplingRate,
+            const Piano *piano,
+            const Key &key,
+            int keyIndex);
+
 private:
 
-    const int NumberOfBins=Key::NumberOfBins;
+    static constexpr int NumberOfBins=Key::NumberOfBins;
 
     SpectrumType mOptimalSuperposition;         ///< Superposition of the partials
     FFT_Implementation mFFT;                    ///< Instance of FFT implementation
-    SpectrumType mCurrentKernel;                ///< The current kernel for the key detection
-    const Key *mCurrentKernelKey;               ///< The key of which mCurrentKernel belongs to
+    FFTComplexVector mKernelFFT;                ///< Fourier transform of the current kernel
+    int mKernelKeyNumber;                       ///< Number of the key mKernelFFT belongs to
+    uint64_t mKernelStamp;                      ///< Content stamp of the spectrum of this key
+    FFTRealVector mSignal;                      ///< Buffer for the signal to be correlated
+    FFTComplexVector mSignalFFT;                ///< Fourier transform of the signal
+    FFTRealVector mCorrelation;                 ///< Correlation of kernel and signal
+    LogBinningPlan mLogBinning;                 ///< Plan for the logarithmic binning of the FFT
+    ZoomAnalyzer mZoomAnalyzer;                 ///< Narrow-band analysis of the selected key
 
 
 private:    
     void   constructLogBinnedSpectrum(FFTDataPointer fftData, SpectrumType &spectrum);
-    SpectrumType constructKernel(const SpectrumType &originalSpectrum);
-    TuningDeviationCurveType computeTuningDeviation(const SpectrumType &kernel, const SpectrumType &signal, int searchSize);
+    void constructKernel(const SpectrumType &originalSpectrum);
+    static uint64_t computeStamp(const SpectrumType &spectrum);
+    TuningDeviationCurveType computeTuningDeviation(const SpectrumType &signal, int searchSize);
+    void evaluateTuningDeviation(TuningDeviationCurveType &out, double centerFrequency,
+                                 double targetFrequency, FrequencyDetectionResult result);
     int    locatePeak (const SpectrumType &spectrum, int m, int width);
     double interpolatePeakPosition (const SpectrumType &spectrum, int m, int width);
     int    findNearestKey (double f, double conertPitch, int numberOfKeys, int keyNumberOfA);
@@ -50,6 +50,8 @@ const double KeyRecognizer::logfmax = log(fmax);
 ///////////////////////////////////////////////////////////////////////////////
 
 KeyRecognizer::KeyRecognizer(KeyRecognizerCallback *callback) :
+    PipelineStage("KeyRecognizer",      // Recognition jobs run on a persistent
+                  QUEUE_CAPACITY),      // worker fed by a latest-wins queue
     mCallback(callback),                // Pointer to the caller
     mFFTPtr(nullptr),                   // Pointer to the Fourier transform
     mConcertPitch(0),                   // Concert pitch in Hz (normally 440)
@@ -93,15 +95,18 @@ void KeyRecognizer::init(bool optimize)
 
 
 //-----------------------------------------------------------------------------
-//			            Start the key recognition thread
+//			            Submit a key recognition job
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Start key recognition.
 ///
-/// Function to start the key recognition thread. This function
-/// is called by the SignalAnalyzer.
-/// \param forceRestart : true if restart of the thread is forced
+/// Function to submit a key recognition job. This function is called by
+/// the SignalAnalyzer for every new Fourier transform. The job is queued
+/// and processed by the persistent worker thread. If the recognition does
+/// not keep pace, the oldest waiting job is dropped (latest wins), so that
+/// the caller never waits.
+/// \param forceRestart : true if running and waiting jobs shall be cancelled
 /// \param piano : pointer to the piano data
 /// \param fftPointer : pointer to the actual FFT
 /// \param selectedKey : Number of the selected key (-1 if none)
@@ -119,33 +124,40 @@ void KeyRecognizer::recognizeKey (
     EptAssert(fftPointer, "The fft data has to exist.");
     EptAssert(fftPointer->isValid(), "Invaild fft data");
 
-    if (forceRestart) stop();                   // if restart forced stop thread
-    else if (isThreadRunning()) return;        // if it is running do nothing
+    if (forceRestart) stop();       // if restart forced cancel all jobs
 
-    // copy data from the piano
-    mPiano = piano;
-    mConcertPitch = piano->getConcertPitch();
-    mNumberOfKeys = piano->getKeyboard().getNumberOfKeys();
-    mKeyNumberOfA = piano->getKeyboard().getKeyNumberOfA4();
-    mFFTPtr = fftPointer;           // save pointer to the Fourier transform
-    mSelectedKey = selectedKey;     // copy selected key
-    mKeyForced = keyForced;         // copy forcing flag
-
-    start();                        // start the thread
+    KeyRecognizerJob job;
+    job.piano = piano;
+    job.fftPointer = fftPointer;
+    job.selectedKey = selectedKey;
+    job.keyForced = keyForced;
+    push(job);                      // submit the job to the worker
 }
 
 
 //-----------------------------------------------------------------------------
-//		  	 Worker function running in an independent thread
+//		  	 Job processing running in an independent thread
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Main worker function for executing the key recognition thread.
+/// \brief Process a single key recognition job.
+///
+/// This function is executed by the worker thread for each job taken
+/// from the queue.
+/// \param job : The job to be processed
 ///////////////////////////////////////////////////////////////////////////////
 
-void KeyRecognizer::workerFunction()
+void KeyRecognizer::processItem(KeyRecognizerJob &job)
 {
-    setThreadName("KeyRecognizer");
+    // copy data from the piano
+    mPiano = job.piano;
+    mConcertPitch = mPiano->getConcertPitch();
+    mNumberOfKeys = mPiano->getKeyboard().getNumberOfKeys();
+    mKeyNumberOfA = mPiano->getKeyboard().getKeyNumberOfA4();
+    mFFTPtr = job.fftPointer;       // save pointer to the Fourier transform
+    mSelectedKey = job.selectedKey; // copy selected key
+    mKeyForced = job.keyForced;     // copy forcing flag
+
     EptAssert(mFFTPtr, "FFT Data have to non zero");
     EptAssert(mFFTPtr->isValid(), "FFT Data have to exist");
     EptAssert(mCallback, "Callback class has to exist");
@@ -188,7 +200,7 @@ void KeyRecognizer::workerFunction()
 double KeyRecognizer::detectForcedFrequency()
 {
     if (mSelectedKey<0 or not mKeyForced) return 0;
-    std::vector<double> &fft = mFFTPtr->fft;
+    const FFTWVector &fft = mFFTPtr->fft;
     const int n = static_cast<int>(mFFTPtr->fft.size());
     const int sr = mFFTPtr->samplingRate;
     auto ftoq = [n,sr] (double f) { return MathTools::roundToInteger(2*n*f/sr); };
@@ -224,7 +236,7 @@ double KeyRecognizer::detectForcedFrequency()
 double KeyRecognizer::detectFrequencyInTreble()
 {
     const double threshold = 0.09;
-    std::vector<double> &fft = mFFTPtr->fft;
+    const FFTWVector &fft = mFFTPtr->fft;
     const int n = static_cast<int>(mFFTPtr->fft.size());
     const int sr = mFFTPtr->samplingRate;
     auto ftoq = [n,sr] (double f) { return MathTools::roundToInteger(2*n*f/sr); };
@@ -301,15 +313,21 @@ double KeyRecognizer::mtof (int m) {
 /// This function maps the FFT spectrum, which is linear in the frequency,
 /// to a logarithmically binned spectrum. To this end the amplitudes
 /// of the FFT power spectrum are evently distributed into
-/// bins of the logarithmic spectrum (mLogSpec).
+/// bins of the logarithmic spectrum (mLogSpec). The binning plan is reused
+/// as long as the size of the FFT and the sampling rate do not change.
 ////////////////////////////////////////////////////////////////////////
 
 void KeyRecognizer::constructLogSpec()
 {
     const int Q = static_cast<int>(mFFTPtr->fft.size());
-    std::function<double(double)> mtoq = [this,Q] (double m)
-        { return 2*fmin*Q/mFFTPtr->samplingRate*pow(fmax/fmin,m/M); };
-    MathTools::coarseGrainSpectrum (mFFTPtr->fft,mLogSpec,mtoq);
+    const int samplingRate = mFFTPtr->samplingRate;
+    if (not mLogBinning.isValid(Q, samplingRate, M))
+    {
+        std::function<double(double)> mtoq = [Q,samplingRate] (double m)
+            { return 2*fmin*Q/samplingRate*pow(fmax/fmin,m/M); };
+        mLogBinning.create(Q, samplingRate, M, mtoq);
+    }
+    mLogBinning.apply(mFFTPtr->fft,mLogSpec);
 }
 
 
@@ -338,7 +356,7 @@ void KeyRecognizer::signalPreprocessing()
     double norm = MathTools::computeNorm(mLogSpec);
     if (norm<=0) return;
     auto decibel = [norm](double x) {return 10*log10(x/norm);};
-    auto dB= MathTools::transformVector<double>(mLogSpec,decibel);
+    auto dB= MathTools::transformVector<FFTRealType>(mLogSpec,decibel);
     Write("02-dB.dat",dB);
 
 
@@ -351,7 +369,7 @@ void KeyRecognizer::signalPreprocessing()
         int b = std::min(M,i+1);
         double sum=0;
         for (int k=a; k<b; ++k) sum+=dB[k]*dB[k];
-        mFlatSpectrum[i]=std::max(0.0,dB[i]+sqrt(sum/(b-a))-5);
+        mFlatSpectrum[i]=static_cast<FFTRealType>(std::max(0.0,dB[i]+sqrt(sum/(b-a))-5));
     }
     Write("03-dBflat.dat",mFlatSpectrum);
 
@@ -395,7 +413,7 @@ void KeyRecognizer::defineKernel ()
     static const int partials=20;  // number of partials to be detected (20)
     static const double B=0.000;   // here still with a constant inharmonicity
 
-    static std::vector<double> kernel(M); //must be static for using fftw3
+    static FFTRealVector kernel(M); //must be static for using fftw3
     kernel.assign(M,0);
 
     // lambda function for setting a peak
@@ -485,7 +503,7 @@ int KeyRecognizer::findNearestKey (double f)
 //			Write function for development purposes
 //-----------------------------------------------------------------------------
 
-void KeyRecognizer::Write(std::string filename, std::vector<double> &v, bool log)
+void KeyRecognizer::Write(std::string filename, FFTRealVector &v, bool log)
 {
 #if CONFIG_ENABLE_XMGRACE
     std::ofstream os(filename);
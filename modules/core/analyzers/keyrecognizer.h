@@ -25,10 +25,11 @@
 #define KEYRECOGNIZER_H
 
 #include "prerequisites.h"
-#include "../system/simplethreadhandler.h"
+#include "../system/pipelinestage.h"
 #include "../messages/messagelistener.h"
 #include "../piano/piano.h"
 #include "../math/fftimplementation.h"
+#include "../math/logbinningplan.h"
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -46,25 +47,44 @@ public:
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Data of a single key recognition job.
+///////////////////////////////////////////////////////////////////////////////
+
+struct KeyRecognizerJob
+{
+    const Piano *piano = nullptr;                       ///< Pointer to the piano data
+    FFTDataPointer fftPointer;                          ///< Pointer to the Fourier transform
+    int selectedKey = -1;                               ///< Number of the selected key
+    bool keyForced = false;                             ///< Flag indicating a forced key
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Module for fast recognition of the pressed key.
 ///
 /// When a key is pressed, the SignalAnalyzer calls the function
-/// recognizeKey to start an independent thread for key recognition on the
-/// basis of the current Fourier transform. The key recognizer transmits the
-/// estimated frequency and the corresponding key number via a callback function.
+/// recognizeKey for every new Fourier transform. The key recognizer is a
+/// stage of the analysis pipeline: The transforms are queued with a
+/// latest-wins policy and processed on a persistent worker thread, so that
+/// the SignalAnalyzer never waits for the recognition. The key recognizer
+/// transmits the estimated frequency and the corresponding key number via
+/// a callback function.
 ////////////////////////////////////////////////////////////////////////////////
 
-class EPT_EXTERN KeyRecognizer : public SimpleThreadHandler
+class EPT_EXTERN KeyRecognizer : public PipelineStage<KeyRecognizerJob>
 {
 private:
     static const int    M;                              ///< Number of bins (powers of 2,3,5)
     static const double fmin;                           ///< Frequency of bin 0
     static const double fmax;                           ///< Frequency of bin M-1
 
+public:
+    static const size_t QUEUE_CAPACITY = 2;             ///< Maximal number of waiting jobs
+
 public:
     KeyRecognizer (KeyRecognizerCallback *callback);    // Constructor
-    ~KeyRecognizer(){}                                  // Empty destructor
+    ~KeyRecognizer(){stop();}                           // Stop the worker thread
 
     void init(bool optimize);                           // Initialize (optimize FFT)
     void recognizeKey(bool forceRestart,                // Recognize a key:
@@ -73,7 +93,7 @@ public:
                       int selectedKey, bool keyForced);
 
 private:
-    void workerFunction() override final;               // Thread execution function
+    void processItem(KeyRecognizerJob &job) override final; // Process a job in the thread
 
     double detectForcedFrequency();                     // Handle forced keys
     double detectFrequencyInTreble();                   // Handle keys in the treble
@@ -91,11 +111,12 @@ private:
     int mNumberOfKeys;                                  ///< Number of piano keys
     int mKeyNumberOfA;                                  ///< Index of the A-key
     FFT_Implementation mFFT;                            ///< Instance of FFT implementation
-    std::vector<double> mLogSpec;                       ///< Logarithmic spectrum (LogSpec)
-    std::vector<double> mFlatSpectrum;                  ///< DoubleLogarithmic spectrum (LogLogSpec)
+    FFTRealVector mLogSpec;                             ///< Logarithmic spectrum (LogSpec)
+    FFTRealVector mFlatSpectrum;                        ///< DoubleLogarithmic spectrum (LogLogSpec)
     FFTComplexVector mKernelFFT;                        ///< Fourier transform of the kernel
     FFTComplexVector mFlatFFT;                          ///< Fourier transform of LogLogSpec
     FFTRealVector mConvolution;                         ///< Convolution vector
+    LogBinningPlan mLogBinning;                         ///< Plan for the construction of mLogSpec
     int mSelectedKey;                                   ///< Number of the actually selected key
     bool mKeyForced;                                    ///< Flag indicating that the key is forced
 
@@ -105,7 +126,7 @@ private:
     double mtof (int m);                                ///< Map bin index to frequency
     int ftom (double f);                                ///< Map frequency to bin index
 
-    void Write(std::string filename, std::vector<double> &v, bool log=true); // only for development
+    void Write(std::string filename, FFTRealVector &v, bool log=true); // only for development
 };
 
 #endif // KEYRECOGNIZER_H
@@ -41,7 +41,8 @@ OverpullEstimator::OverpullEstimator() :
     mPianoType(piano::PT_COUNT),
     mNumberOfKeys(0),
     mNumberOfBassKeys(0),
-    mConcertPitch(0)
+    mConcertPitch(0),
+    mNumberOfUpdates(0)
 {
 }
 
@@ -66,6 +67,7 @@ void OverpullEstimator::init (const Piano *piano)
     mConcertPitch = piano->getConcertPitch();
     mPianoType = piano->getPianoType();
     computeInteractionMatrix();
+    mWeightedRedMarkers.clear();
 }
 
 
@@ -96,9 +98,7 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
     LogI("Compute overpull interaction matrix");
 
     // resize and reset the interaction matrix:
-    R.resize(K);
-    for (auto &row : R) row.resize(K);
-    for (auto &row : R) row.assign(K,0);
+    R.assign(K*K,0);
 
     double DL=0,DR=0,SL=0,SR=0,SB=0,SN=0,shift=0;
 
@@ -181,10 +181,10 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
     // NORMALIZATION
     double sum = 0;
     double p = 0.8; // weight of sound board deformation 80 %
-    for (int j=0; j<K; ++j) for (int k=0; k<K; ++k) sum += (R[j][k] = response(j,k));
+    for (int j=0; j<K; ++j) for (int k=0; k<K; ++k) sum += (interaction(j,k) = response(j,k));
     sum /= K;
     for (int j=0; j<K; ++j) for (int k=0; k<K; ++k)
-        R[j][k] *= p * averagePull / sum;
+        interaction(j,k) *= p * averagePull / sum;
 
 
     // BRIDGE TILT
@@ -194,12 +194,12 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
     for (int k=B; k<K; k++) avstring += 1.0/stringlength(k);
     avstring /= K;
     double prefactor = amplitude / sqrt(2*3.141) / sigma / avstring / 0.7;
-    for (int j=0; j<B; ++j) for (int k=0; k<B; ++k) R[j][k] += prefactor*exp(-0.5*(j-k)*(j-k)/sigma/sigma)/SB;
-    for (int j=B; j<K; ++j) for (int k=B; k<K; ++k) R[j][k] += prefactor*exp(-0.5*(j-k)*(j-k)/sigma/sigma)/stringlength(j);
+    for (int j=0; j<B; ++j) for (int k=0; k<B; ++k) interaction(j,k) += prefactor*exp(-0.5*(j-k)*(j-k)/sigma/sigma)/SB;
+    for (int j=B; j<K; ++j) for (int k=B; k<K; ++k) interaction(j,k) += prefactor*exp(-0.5*(j-k)*(j-k)/sigma/sigma)/stringlength(j);
 
 //    // Compute average (only for testing)
 //    sum=0;
-//    for (int j=0; j<K; ++j) for (int k=0; k<K; ++k) sum += R[j][k];
+//    for (int j=0; j<K; ++j) for (int k=0; k<K; ++k) sum += interaction(j,k);
 //    std::cout << "************************" << sum/K << "******************************" << std::endl;
 
 //    // Write data (only for testing purposes)
@@ -208,7 +208,7 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
 //    for (int j=0; j<K; ++j)
 //    {
 //        os << "{";
-//        for (int k=0; k<K-1; ++k) os << R[j][k] << ",";
+//        for (int k=0; k<K-1; ++k) os << interaction(j,k) << ",";
 //        os << R[j][K-1];
 //        if (j!=K-1) os << "},\n";
 //        else os << "}};" << std::endl;
@@ -219,7 +219,7 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
 //    for (int j=0; j<K; ++j)
 //    {
 //        double sum=0;
-//        for (int k=0; k<K; ++k) sum += R[j][k];
+//        for (int k=0; k<K; ++k) sum += interaction(j,k);
 //        os << sum << std::endl;
 //    }
 //    os.close();
@@ -228,40 +228,46 @@ void OverpullEstimator::computeInteractionMatrix (double averagePull)
 
 
 //-----------------------------------------------------------------------------
-//                            Compute overpull
+//                            Compute overpulls
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Compute the required overpull on the basis of the interaction
-/// matrix.
+/// \brief Compute the required overpulls of all keys on the basis of the
+/// interaction matrix.
 ///
 /// This function first checks whether enough red markers have been set.
-/// Then it computed the overpull according to these markers.
-/// \param keynumber : Number of the key to be tuned
+/// Then it computes the overpulls according to these markers. The product
+/// of the interaction matrix with the weighted markers is updated only for
+/// those markers which have changed since the last call.
 /// \param piano : Pointer to the piano structure
-/// \return Overpull in cents
+/// \return Vector of the overpulls of all keys in cents
 ///////////////////////////////////////////////////////////////////////////////
 
-double OverpullEstimator::getOverpull (int keynumber, const Piano *piano)
+const std::vector<double> &OverpullEstimator::getOverpulls (const Piano *piano)
 {
     // CHECK PARAMETERS FOR CONSISTENCY, OTHERWISE RETURN 0
-    if (not piano) return 0;
+    mOverpulls.clear();
+    if (not piano) return mOverpulls;
     int K = piano->getKeyboard().getNumberOfKeys();
     int B = piano->getKeyboard().getNumberOfBassKeys();
     double cpratio = piano->getConcertPitch() / 440.0;
-    if (K<=0 or B<=0 or keynumber<0 or keynumber>=K) return 0;
+    if (K<=0 or B<=0) return mOverpulls;
+    mOverpulls.assign(K,0);
 
     // IF KEYBOARD PARAMETERS OR PITCH HAS CHANGED RE-INITIALIZE AGAIN
     if (K != mNumberOfKeys or B != mNumberOfBassKeys
         or   piano->getConcertPitch() != mConcertPitch
         or piano->getPianoType() != mPianoType) init(piano);
+    if (R.size() != static_cast<size_t>(K*K)) return mOverpulls;
 
     //
-    std::vector<double> weightedRedMarkers (K,0);
+    std::vector<double> &weightedRedMarkers = mNewRedMarkers;
+    weightedRedMarkers.assign(K,0);
     const int maxGapsize = 7;
     int gapsize = 0;
     int lastkey = 0;
     double lastchi = 0;
+    bool complete = true;
     for (int k=0; k<K; ++k)
     {
         double computed   = piano->getKey(k).getComputedFrequency();
@@ -274,21 +280,74 @@ double OverpullEstimator::getOverpull (int keynumber, const Piano *piano)
             gapsize=0;
         }
         else gapsize++;
-        if (gapsize > maxGapsize) return 0;
+        if (gapsize > maxGapsize) complete = false;
         if (k==K-1 and gapsize>0)
             weightedRedMarkers[lastkey] += lastchi*gapsize;
     }
 
-    // COMPUTE CURRENTLY NEEDED OVERPULL
-    double overpull = 0, totaldeviation = 0;
-    for (int k=0; k<K; k++) if (weightedRedMarkers[k])
+    // UPDATE THE PRODUCT OF THE INTERACTION MATRIX WITH THE MARKERS
+    if (mWeightedRedMarkers.size() != static_cast<size_t>(K)
+            or mNumberOfUpdates >= MAXIMAL_NUMBER_OF_UPDATES)
     {
-        totaldeviation += weightedRedMarkers[k];
-        overpull -= weightedRedMarkers[k] * R[keynumber][k];
+        mWeightedRedMarkers = weightedRedMarkers;
+        computeResponse();
     }
-
+    else for (int k=0; k<K; ++k) if (weightedRedMarkers[k] != mWeightedRedMarkers[k])
+    {
+        updateResponse(k, weightedRedMarkers[k] - mWeightedRedMarkers[k]);
+        mWeightedRedMarkers[k] = weightedRedMarkers[k];
+    }
+    if (not complete) return mOverpulls;
 
     // THE OVERPULL IS ONLY SHOWN IF THE PIANO IS ON AVERAGE MORE THAN 5 CENTS FLAT
-    if (fabs(totaldeviation/K)>5) return overpull;
-    else return 0;
+    double totaldeviation = 0;
+    for (int k=0; k<K; k++) totaldeviation += mWeightedRedMarkers[k];
+    if (fabs(totaldeviation/K)>5) mOverpulls = mResponse;
+    return mOverpulls;
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Matrix-vector product of the response
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the overpull response to all weighted markers.
+///
+/// The product is computed column by column, so that the matrix is
+/// traversed in the order of its memory layout.
+///////////////////////////////////////////////////////////////////////////////
+
+void OverpullEstimator::computeResponse ()
+{
+    mResponse.assign(mNumberOfKeys,0);
+    mNumberOfUpdates = 0;
+    for (int k=0; k<mNumberOfKeys; ++k) if (mWeightedRedMarkers[k])
+    {
+        updateResponse(k, mWeightedRedMarkers[k]);
+    }
+    mNumberOfUpdates = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//                         Rank-1 update of the response
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Update the overpull response to a change of a single marker.
+///
+/// If the weighted marker of key k changes by delta, the overpull of each
+/// key j changes by -R[j][k]*delta. The rounding errors accumulated by these
+/// updates are removed by recomputing the full product from time to time.
+/// \param k : Number of the key whose marker has changed
+/// \param delta : Change of the weighted marker
+///////////////////////////////////////////////////////////////////////////////
+
+void OverpullEstimator::updateResponse (int k, double delta)
+{
+    const double *column = R.data() + static_cast<size_t>(k) * mNumberOfKeys;
+    double *response = mResponse.data();
+    for (int j=0; j<mNumberOfKeys; ++j) response[j] -= delta * column[j];
+    ++mNumberOfUpdates;
 }
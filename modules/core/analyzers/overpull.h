@@ -47,26 +47,47 @@
 /// vanishes entirely. That is, for each key the overpull of all other keys
 /// is newly calculated.
 ///
+/// The overpulls of all keys are computed at once as the product of the
+/// response matrix with the vector of weighted deviations. The product is
+/// kept between successive calls. If only a few deviations have changed,
+/// as it is the case during tuning, the product is updated by adding the
+/// corresponding columns of the matrix (rank-1 updates), hence the cost
+/// per call is linear in the number of keys.
+///
 /// The instance of the overpull estimator is held by the SignalAnalyzer.
 ///////////////////////////////////////////////////////////////////////////////
 
 class EPT_EXTERN OverpullEstimator
 {
+public:
+    static const int MAXIMAL_NUMBER_OF_UPDATES = 1000;  ///< Rank-1 updates before recomputing the product
+
 public:
     OverpullEstimator();
     ~OverpullEstimator() {}
 
     void init (const Piano *piano);
-    double getOverpull (int keynumber, const Piano *piano);
+    const std::vector<double> &getOverpulls (const Piano *piano);
 
 private:
     piano::PianoType mPianoType;        ///< Piano type (upright/grand)
     int mNumberOfKeys;                  ///< Total number of keys
     int mNumberOfBassKeys;              ///< Keys on the bass bridge
     double mConcertPitch;               ///< Concert pitch (A4)
-    std::vector<std::vector<float>> R;  ///< Response matrix
+    std::vector<double> R;              ///< Response matrix, stored column by column
+
+    std::vector<double> mWeightedRedMarkers;    ///< Weighted deviations entering mResponse
+    std::vector<double> mNewRedMarkers;         ///< Weighted deviations of the current call
+    std::vector<double> mResponse;              ///< Product of R with the weighted deviations
+    std::vector<double> mOverpulls;             ///< Overpulls returned to the caller
+    int mNumberOfUpdates;                       ///< Rank-1 updates since the last full product
+
+    /// \brief Element R[j][k]: Response of string j to a pull of string k
+    double &interaction (int j, int k) { return R[k * mNumberOfKeys + j]; }
 
     void computeInteractionMatrix (double averagePull = 0.22);
+    void computeResponse ();
+    void updateResponse (int k, double delta);
 };
 
 #endif // OVERPULL_H
@@ -31,6 +31,7 @@
 #include "../messages/messageprojectfile.h"
 #include "../messages/messagenewfftcalculated.h"
 #include "../messages/messagefinalkey.h"
+#include "../messages/messagekeydelta.h"
 #include "../messages/messagemodechanged.h"
 #include "../messages/messagepreliminarykey.h"
 #include "../messages/messagekeyselectionchanged.h"
@@ -55,11 +56,13 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 SignalAnalyzer::SignalAnalyzer(AudioRecorder *recorder) :
+    SimpleThreadHandler(true),
     mPiano(nullptr),
     mDataBuffer(),
     mAudioRecorder(recorder),
     mRecording(false),
     mKeyRecognizer(this),
+    mAnalysisStage(*this),
     mSelectedKey(-1),
     mKeyForced(false),
     mAnalyzerRole(ROLE_IDLE)
@@ -98,10 +101,52 @@ void SignalAnalyzer::init()
 
 void SignalAnalyzer::stop()
 {
-    mKeyRecognizer.stop();
+    stopPipeline();
     SimpleThreadHandler::stop();
 }
 
+
+//-----------------------------------------------------------------------------
+//                     Stop the consumer stages of the pipeline
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Stop the KeyRecognizer and the analysis stage
+///
+/// Running jobs are cancelled and waiting spectra are discarded. The stages
+/// are restarted automatically by the next spectrum.
+///////////////////////////////////////////////////////////////////////////////
+
+void SignalAnalyzer::stopPipeline()
+{
+    mKeyRecognizer.stop();
+    mAnalysisStage.stop();
+}
+
+
+//-----------------------------------------------------------------------------
+//                          Log the pipeline counters
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Log the counters of the queues feeding the pipeline stages
+///
+/// Dropped spectra indicate that a stage could not keep pace with the
+/// production of Fourier transforms.
+///////////////////////////////////////////////////////////////////////////////
+
+void SignalAnalyzer::logPipelineStatistics()
+{
+    auto log = [] (const char *stage, const QueueStatistics &statistics)
+    {
+        LogI("%s: %d spectra received, %d processed, %d dropped, maximal queue depth %d",
+             stage, static_cast<int>(statistics.pushed), static_cast<int>(statistics.processed),
+             static_cast<int>(statistics.dropped), static_cast<int>(statistics.maximalDepth));
+    };
+    log("KeyRecognizer", mKeyRecognizer.getStatistics());
+    if (mAnalyzerRole == ROLE_ROLLING_FFT) log("SignalAnalysis", mAnalysisStage.getStatistics());
+}
+
 //-----------------------------------------------------------------------------
 //			            Message receiver and dispatcher
 //-----------------------------------------------------------------------------
@@ -250,8 +295,9 @@ void SignalAnalyzer::workerFunction()
         // Send message
         MessageHandler::send<MessageSignalAnalysis>(MessageSignalAnalysis::Status::STARTED);
 
-        // stop the KeyRecognizer
-        mKeyRecognizer.stop();
+        // stop the KeyRecognizer and the analysis stage
+        stopPipeline();
+        logPipelineStatistics();
 
         // post process after recording
         recordPostprocessing();
@@ -287,6 +333,10 @@ void SignalAnalyzer::recordSignal()
     // Reset the statistics for the majority of recognized keys
     mKeyCountStatistics.clear();
 
+    // Reset the counters of the pipeline
+    mKeyRecognizer.resetStatistics();
+    mAnalysisStage.resetStatistics();
+
     // Create a shared pointer to a vector containing the powerspectrum
     mPowerspectrum = std::make_shared<FFTData>();
     EptAssert(mPowerspectrum, "powerspectrum is accessed after while loop, be sure it is a valid pointer initially");
@@ -303,6 +353,9 @@ void SignalAnalyzer::recordSignal()
     // get the sampling rate
     uint samplingrate = mAudioRecorder->getSampleRate();
 
+    // In the recording mode the spectrum is computed incrementally
+    if (mAnalyzerRole == ROLE_RECORD_KEYSTROKE) mStreamingSpectrum.init(samplingrate);
+
     // Loop that continuously reads the audio stream and performs FFTs
     while (mRecording and not cancelThread())
     {
@@ -311,42 +364,66 @@ void SignalAnalyzer::recordSignal()
         if (packet.size() > 0)
         {
             // lock the data puffer if new data available during compile comutation run
-            std::lock_guard<std::mutex> lock(mDataBufferMutex);
+            std::unique_lock<std::mutex> lock(mDataBufferMutex);
 
             for (auto &d : packet) mDataBuffer.push_back(d);
+            const size_t bufferSize = mDataBuffer.size();
 
             if (mAnalyzerRole == ROLE_RECORD_KEYSTROKE) {
-                if (mDataBuffer.size() == mDataBuffer.maximum_size()) {
+                if (bufferSize == mDataBuffer.maximum_size()) {
                     LogW("Audio buffer size in SignalAnalyzer reached.");
                 }
+
+                // The running spectrum keeps its own history,
+                // hence the buffer can be released here
+                lock.unlock();
+
+                // only the new data enters the running spectrum
+                mStreamingSpectrum.pushSamples(packet);
             }
 
             // If the buffer has accumulated a certain minimum of data
-            if (mDataBuffer.size() > (samplingrate * MINIMAL_FFT_INTERVAL_IN_MILLISECONDS) / 1000)
+            if (bufferSize > (samplingrate * MINIMAL_FFT_INTERVAL_IN_MILLISECONDS) / 1000)
             {
+                if (mAnalyzerRole == ROLE_RECORD_KEYSTROKE)
+                {
+                    // no data in buffer
+                    if (not mStreamingSpectrum.hasData()) continue;
 
-                // Get audio data and make it suitable for analysis
-                mProprocessedSignal = mDataBuffer.getOrderedData();
+                    FFTDataPointer powerspectrum = mStreamingSpectrum.getPowerspectrum();
+                    if (not powerspectrum) continue;
+                    mPowerspectrum = powerspectrum;
 
-                // check if there is data in the buffer
-                bool dataInBuffer = false;
-                for (auto &d : mProprocessedSignal) {
-                    if (d * d > 0) {
-                        // this element contains data
-                        dataInBuffer = true;
-                        break;
-                    }
-                }
-                if (!dataInBuffer) {// no data in buffer
-                    continue;
+                    // process the running spectrum
+                    spectrumProcessing();
                 }
+                else
+                {
+                    // Get audio data and make it suitable for analysis. The buffer
+                    // is released before the FFT since the analysis stage reads it.
+                    mDataBuffer.copyOrderedData(mProprocessedSignal);
+                    lock.unlock();
+
+                    // check if there is data in the buffer
+                    bool dataInBuffer = false;
+                    for (auto &d : mProprocessedSignal) {
+                        if (d * d > 0) {
+                            // this element contains data
+                            dataInBuffer = true;
+                            break;
+                        }
+                    }
+                    if (!dataInBuffer) {// no data in buffer
+                        continue;
+                    }
 
-                // preprocess signal
-                signalPreprocessing(mProprocessedSignal);
-                CHECK_CANCEL_THREAD;
+                    // preprocess signal
+                    signalPreprocessing(mProprocessedSignal);
+                    CHECK_CANCEL_THREAD;
 
-                // process signal
-                signalProcessing(mProprocessedSignal, samplingrate);
+                    // process signal
+                    signalProcessing(mProprocessedSignal, samplingrate);
+                }
 
                 // Finally let's wait until a certain minimal time has elapsed.
                 timer.waitUntil (MINIMAL_FFT_INTERVAL_IN_MILLISECONDS);
@@ -363,10 +440,21 @@ void SignalAnalyzer::recordSignal()
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Analyze the final signal (in recording mode only)
+/// \brief Analyze the signal
+///
+/// In the recording mode this function is called once for the final
+/// spectrum. In the tuning mode it is executed by the analysis stage for
+/// every new spectrum.
+///
+/// If the preprocessed time signal is passed as well, the frequency of the
+/// selected key is determined by a narrow-band zoom analysis of the signal
+/// instead of the full spectrum (see CONFIG_ZOOM_TUNING_ANALYSIS).
+/// \param powerspectrum : The power spectrum to be analyzed
+/// \param signal : The preprocessed signal (optional, tuning mode only)
 ///////////////////////////////////////////////////////////////////////////////
 
-void SignalAnalyzer::analyzeSignal()
+void SignalAnalyzer::analyzeSignal(FFTDataPointer powerspectrum,
+                                   std::shared_ptr<const FFTWVector> signal)
 {
     CHECK_CANCEL_THREAD;
 
@@ -376,7 +464,10 @@ void SignalAnalyzer::analyzeSignal()
 
     // check the audio signal for possible
     // clipping effects and unusually long strings of zero amplitudes
-    detectClipping(mDataBuffer.getOrderedData());
+    {
+        std::lock_guard<std::mutex> lock(mDataBufferMutex);
+        detectClipping(mDataBuffer);
+    }
 
     CHECK_CANCEL_THREAD;
 
@@ -404,7 +495,7 @@ void SignalAnalyzer::analyzeSignal()
     if (mAnalyzerRole == ROLE_RECORD_KEYSTROKE)
     {
         // returns a pair consisting of error code and key-shared-ptr
-        auto result = mFFTAnalyser.analyse(mPiano, mPowerspectrum, keynumber);
+        auto result = mFFTAnalyser.analyse(mPiano, powerspectrum, keynumber);
 
         if (result.first != FFTAnalyzerErrorTypes::ERR_NONE) // if error
             MessageHandler::send<MessageNewFFTCalculated>(result.first);
@@ -417,17 +508,21 @@ void SignalAnalyzer::analyzeSignal()
     }
     else if (mAnalyzerRole == ROLE_ROLLING_FFT)
     {
-        std::shared_ptr<Key> key = std::make_shared<Key>(mPiano->getKey(keynumber));
-        FrequencyDetectionResult result = mFFTAnalyser.detectFrequencyOfKnownKey(mPowerspectrum, mPiano, *key, keynumber);
+        // The analysis stage runs concurrently to the PianoManager, which
+        // modifies the keys in place. Therefore, analyze a copy of the key.
+        const Key key(mPiano->getKey(keynumber));
+        FrequencyDetectionResult result = (signal ?
+            mFFTAnalyser.detectFrequencyOfKnownKey(*signal, powerspectrum->samplingRate, mPiano, key, keynumber) :
+            mFFTAnalyser.detectFrequencyOfKnownKey(powerspectrum, mPiano, key, keynumber));
 
         if (result->error != FFTAnalyzerErrorTypes::ERR_NONE) // if error
             MessageHandler::send<MessageNewFFTCalculated>(result->error);
         else
         {
-            key->setTunedFrequency(result->detectedFrequency);
-            MessageHandler::send<MessageFinalKey>(keynumber, key);
+            // send only the new tuned frequency, not a copy of the key
+            MessageHandler::send<MessageKeyDelta>(keynumber, result->detectedFrequency);
         }
-        result->overpullInCents = key->getOverpull();
+        result->overpullInCents = key.getOverpull();
         MessageHandler::send<MessageTuningDeviation>(result);
     }
 }
@@ -439,8 +534,9 @@ void SignalAnalyzer::analyzeSignal()
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Process the singal after recording has finsihed
 ///
-/// In the ROLE_RECORD_KEYSTROKE this will perform the actual analysis of the
-/// complete recorded signal while in the ROLE_ROLLING_FFT this wont do anything.
+/// In the ROLE_RECORD_KEYSTROKE this will compute the full-resolution
+/// Fourier transform of the complete recorded signal and perform the actual
+/// analysis while in the ROLE_ROLLING_FFT only the overpulls are updated.
 ///////////////////////////////////////////////////////////////////////////////
 
 void SignalAnalyzer::recordPostprocessing()
@@ -449,8 +545,33 @@ void SignalAnalyzer::recordPostprocessing()
 
     if (mAnalyzerRole == ROLE_RECORD_KEYSTROKE)
     {
+        // The spectrum computed during the recording has a limited
+        // resolution. Transform the complete signal once.
+        mDataBufferMutex.lock();
+        mDataBuffer.copyOrderedData(mProprocessedSignal);
+        mDataBufferMutex.unlock();
+        if (mStreamingSpectrum.hasData())
+        {
+            signalPreprocessing(mProprocessedSignal);
+            CHECK_CANCEL_THREAD;
+
+            if (mProprocessedSignal.size() > 0)
+            {
+                mPowerspectrum = std::make_shared<FFTData>();
+                mPowerspectrum->samplingRate = mAudioRecorder->getSampleRate();
+                PerformFFT(mProprocessedSignal, mPowerspectrum->fft);
+                CHECK_CANCEL_THREAD;
+
+                std::shared_ptr<FFTPolygon> polygon = std::make_shared<FFTPolygon>();
+                createPolygon (mPowerspectrum->fft, *polygon.get());
+                MessageHandler::send<MessageNewFFTCalculated>
+                        (MessageNewFFTCalculated::FFTMessageTypes::FinalFFT,
+                         mPowerspectrum, polygon);
+            }
+        }
+
         // do the actual fft analysis
-        analyzeSignal();
+        analyzeSignal(mPowerspectrum);
         // Debug output for signals
 #if CONFIG_ENABLE_XMGRACE
         std::cout << "SignalAnalyzer: Writing xmgrace files" << std::endl;
@@ -478,17 +599,19 @@ void SignalAnalyzer::recordPostprocessing()
 /// \brief Update overpulls
 ///
 /// This function calls the overpull module to compute a new overpull value.
-/// If the new value is different from the old one the new value is stored
-/// and a message is sent to the GUI to update the corresponding marker.
+/// If the new value is different from the old one a MessageKeyDelta is sent
+/// to the PianoManager which stores the new value and informs the GUI to
+/// update the corresponding marker.
 ///////////////////////////////////////////////////////////////////////////////
 
 void SignalAnalyzer::updateOverpull ()
 {
-    int K = mPiano->getKeyboard().getNumberOfKeys();
+    // Compute the new overpull values depending on the current tune
+    const std::vector<double> &overpulls = mOverpull.getOverpulls(mPiano);
+    const int K = static_cast<int>(overpulls.size());
     for (int keynumber=0; keynumber<K; ++keynumber)
     {
-        // Compute the new overpull value depending on the current tune
-        double overpull = mOverpull.getOverpull(keynumber,mPiano);
+        double overpull = overpulls[keynumber];
 
         // Get the currently displayed overpull value and compute the change
         double currentoverpull = mPiano->getKey(keynumber).getOverpull();
@@ -497,13 +620,12 @@ void SignalAnalyzer::updateOverpull ()
         // If more change than 1/10 cents then
         if (fabs(change) >= 0.1 or (currentoverpull!=0 and overpull==0))
         {
-            // set new overpull value
-            std::shared_ptr<Key> key = std::make_shared<Key>(mPiano->getKey(keynumber));
-            double existingtune = key->getTunedFrequency();
+            // set new overpull value, this informs the tuning curve window
+            double existingtune = mPiano->getKey(keynumber).getTunedFrequency();
+            double newtune = 0;
             if (existingtune>20 and currentoverpull!=0)
-                key->setTunedFrequency(existingtune*pow(2,change/1200.0));
-            key->setOverpull(overpull); // this informs the tuning curve window
-            MessageHandler::send<MessageFinalKey>(keynumber, key);
+                newtune = existingtune*pow(2,change/1200.0);
+            MessageHandler::send<MessageKeyDelta>(keynumber, newtune, overpull);
         }
     }
 
@@ -606,10 +728,8 @@ double SignalAnalyzer::signalPreprocessing(FFTWVector &signal)
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Function for signal processing.
 ///
-/// Create an FFT vector and perform the FFT.
-///
-/// On ROLE_ROLLING_FFT this will permanentely send FinalFFT
-/// On ROLE_RECORD_KEYSTRO this will peramaentely send NewFFT
+/// Create an FFT vector and perform the FFT. Then the resulting power
+/// spectrum is processed by calling spectrumProcessing().
 ///////////////////////////////////////////////////////////////////////////////
 
 void SignalAnalyzer::signalProcessing(FFTWVector &signal, int samplingrate) {
@@ -621,11 +741,53 @@ void SignalAnalyzer::signalProcessing(FFTWVector &signal, int samplingrate) {
         return;
     }
 
+    // keep a copy of the signal for the zoom analysis, since the FFT pads
+    // the signal with zeros. The buffer is reused unless the analysis stage
+    // still holds it.
+#if CONFIG_ZOOM_TUNING_ANALYSIS
+    if (mAnalyzerRole == ROLE_ROLLING_FFT)
+    {
+        if (mAnalysisSignal and mAnalysisSignal.use_count() == 1)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            mAnalysisSignal->assign(signal.begin(), signal.end());
+        }
+        else mAnalysisSignal = std::make_shared<FFTWVector>(signal);
+    }
+    else mAnalysisSignal.reset();
+#endif
+
     mPowerspectrum = std::make_shared<FFTData>();
     mPowerspectrum->samplingRate = samplingrate;
     PerformFFT(signal, mPowerspectrum->fft);
     if (cancelThread()) return;
 
+    spectrumProcessing();
+}
+
+
+//-----------------------------------------------------------------------------
+//			                Spectrum processing
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Function for processing the current power spectrum.
+///
+/// Sends the spectrum to the GUI and hands it over to the KeyRecognizer
+/// and, in the tuning mode, to the analysis stage. Both run on their own
+/// worker threads, hence this function does not wait for the results.
+///
+/// On ROLE_ROLLING_FFT this will permanentely send FinalFFT
+/// On ROLE_RECORD_KEYSTRO this will peramaentely send NewFFT
+///////////////////////////////////////////////////////////////////////////////
+
+void SignalAnalyzer::spectrumProcessing() {
+    EptAssert(mPowerspectrum, "Power spectrum has to be computed first");
+    if (mPowerspectrum->fft.size() == 0) {
+        LogW("Empty spectrum. Cancelling the spectrum processing");
+        return;
+    }
+
     // The FFT is too long to be plotted. Therefore, we
     // create here a shorter polygon and transmit it by a message
     std::shared_ptr<FFTPolygon> polygon = std::make_shared<FFTPolygon>();
@@ -639,8 +801,9 @@ void SignalAnalyzer::signalProcessing(FFTWVector &signal, int samplingrate) {
     // recognize key
     mKeyRecognizer.recognizeKey(false, mPiano, mPowerspectrum, mSelectedKey, mKeyForced);
 
+    // hand over the spectrum to the analysis stage
     if (mAnalyzerRole == ROLE_ROLLING_FFT) {
-        analyzeSignal();
+        mAnalysisStage.push({mPowerspectrum, mAnalysisSignal});
     }
 
     // automatic key selection
@@ -665,18 +828,24 @@ void SignalAnalyzer::signalProcessing(FFTWVector &signal, int samplingrate) {
 ///
 /// This function transforms the real-valued signal of length N to a
 /// complex-valued Fourier transform of length N/2+1. Then it computes the
-/// power spectrum by computing the intensities (squares).
+/// power spectrum by computing the intensities (squares). Both steps are
+/// carried out in place in the memory of the power spectrum.
+///
+/// If CONFIG_FFT_ZERO_PADDING is set, the signal is zero-padded to the next
+/// size with small prime factors. This keeps the number of different plans
+/// small and avoids slow transforms of sizes with large prime factors.
+/// Note that the padding changes the size and the bin spacing of the
+/// power spectrum received by all consumers.
 /// \param signal : reference to the vector of the incoming audio signal.
 /// \param powerspectrum : reference to the resulting powerspectrum.
 ///////////////////////////////////////////////////////////////////////////////
 
 void SignalAnalyzer::PerformFFT (FFTWVector &signal, FFTWVector &powerspectrum)
 {
-    FFTComplexVector cvec;
-    mFFT.calculateFFT(signal,cvec);
-    powerspectrum.clear();
-    for (auto &c : cvec)
-        powerspectrum.push_back (c.real()*c.real()+c.imag()*c.imag());
+#if CONFIG_FFT_ZERO_PADDING
+    signal.resize(FFT_Implementation::getFastSize(signal.size()), 0);
+#endif
+    mFFT.calculatePowerspectrum(signal,powerspectrum);
 }
 
 
@@ -694,23 +863,34 @@ void SignalAnalyzer::PerformFFT (FFTWVector &signal, FFTWVector &powerspectrum)
 /// Similarly, some audio devices transmit intermittent data with random
 /// strings of zeros in between. This is detected by counting the number of
 /// vanishing PCM amplitudes.
-/// \param signal : vector holding the incoming audio signal
+///
+/// The data is read in place from the two segments of the buffer, the
+/// caller has to lock the buffer.
+/// \param buffer : circular buffer holding the incoming audio signal
 /// \return true if a problem has been detected, false if not
 ///////////////////////////////////////////////////////////////////////////////
 
-bool SignalAnalyzer::detectClipping(FFTWVector signal)
+bool SignalAnalyzer::detectClipping(const CircularBuffer<FFTWType> &buffer)
 {
     int nullcnt=0, maxcnt=0, mincnt=0;
     double maxamp=0, minamp=0;
-    for (auto &y : signal)
+    auto count = [&] (const FFTWType *data, size_t size)
     {
-        if (y>maxamp) maxamp=y;
-        else if (y>=maxamp*0.99) maxcnt++;
-        if (y<minamp) minamp=y;
-        else if (y<=minamp*0.99) mincnt++;
-        if (y==0) nullcnt++;
-    }
-    const int threshold = static_cast<int>(signal.size()) / 50;
+        for (size_t i = 0; i < size; ++i)
+        {
+            const double y = data[i];
+            if (y>maxamp) maxamp=y;
+            else if (y>=maxamp*0.99) maxcnt++;
+            if (y<minamp) minamp=y;
+            else if (y<=minamp*0.99) mincnt++;
+            if (y==0) nullcnt++;
+        }
+    };
+    const CircularBuffer<FFTWType>::Segments segments = buffer.getSegments();
+    count(segments.first, segments.firstSize);
+    count(segments.second, segments.secondSize);
+
+    const int threshold = static_cast<int>(segments.size()) / 50;
     if (maxcnt+mincnt > threshold)
     {
         LogW("SignalAnalyzer: High-amplitude clipping detected");
@@ -29,6 +29,7 @@
 #include "prerequisites.h"
 
 #include "system/simplethreadhandler.h"
+#include "system/pipelinestage.h"
 #include "messages/messagelistener.h"
 #include "audio/circularbuffer.h"
 #include "math/fftimplementation.h"
@@ -36,6 +37,7 @@
 #include "fftanalyzer.h"
 #include "keyrecognizer.h"
 #include "overpull.h"
+#include "streamingspectrum.h"
 
 class AudioRecorder;
 
@@ -46,10 +48,19 @@ class AudioRecorder;
 /// It contains another cyclic buffer which can hold audio data of
 /// about a minute. After detecting a keystroke, the AudioRecorderAdapter
 /// sends a message to start the SignalAnalyzer. During recording the
-/// SignalAnalyzer continuously performs Fourer transformations on the
-/// current signal. When the recording is finished, a final Fourier
+/// SignalAnalyzer continuously updates a running power spectrum of the
+/// current signal which only processes the newly arrived data. When the
+/// recording is finished, a final full-resolution Fourier
 /// transformation is carried out. Various steps for signal preprocessing
 /// are included as well.
+///
+/// The analysis is organized as a pipeline: The thread of the
+/// SignalAnalyzer produces the Fourier transforms. These are handed over
+/// to the KeyRecognizer and, in the tuning mode, to the analysis stage
+/// running the FFTAnalyzer. Each stage runs on its own persistent worker
+/// and is fed by a small latest-wins queue, so that the producer is never
+/// blocked by the consumers. The counters of the queues are logged after
+/// each recording.
 ///////////////////////////////////////////////////////////////////////////////
 
 class EPT_EXTERN SignalAnalyzer :
@@ -60,6 +71,7 @@ class EPT_EXTERN SignalAnalyzer :
 public:
     static const int AUDIO_BUFFER_SIZE_IN_SECONDS = 60;             ///< Maximal size of the audio buffer
     static const int MINIMAL_FFT_INTERVAL_IN_MILLISECONDS = 150;    ///< Time interval for at most one FFT
+    static const size_t ANALYSIS_QUEUE_CAPACITY = 1;                ///< Waiting spectra of the analysis stage
 
 private:
 
@@ -70,6 +82,33 @@ private:
         ROLE_ROLLING_FFT,           ///< Performing rolling ffts in tuning mode
     };
 
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Data handed over to the analysis stage
+    ///////////////////////////////////////////////////////////////////////////
+    struct AnalysisItem
+    {
+        FFTDataPointer powerspectrum;                   ///< Power spectrum of the signal
+        std::shared_ptr<const FFTWVector> signal;       ///< Preprocessed signal, may be empty
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Pipeline stage analyzing the spectra in the tuning mode
+    ///////////////////////////////////////////////////////////////////////////
+    class AnalysisStage : public PipelineStage<AnalysisItem>
+    {
+    public:
+        AnalysisStage(SignalAnalyzer &analyzer) :
+            PipelineStage("SignalAnalysis", ANALYSIS_QUEUE_CAPACITY),
+            mAnalyzer(analyzer) {}
+        ~AnalysisStage() { stop(); }
+
+    private:
+        void processItem(AnalysisItem &item) override final
+        { mAnalyzer.analyzeSignal(item.powerspectrum, item.signal); }
+
+        SignalAnalyzer &mAnalyzer;  ///< The analyzer owning the stage
+    };
+
 public:
     SignalAnalyzer(AudioRecorder *recorder);
     ~SignalAnalyzer() {}
@@ -88,13 +127,17 @@ private:
     void workerFunction() override final;                           // Thread execution function
 
     void recordSignal();
-    void analyzeSignal();
+    void analyzeSignal(FFTDataPointer powerspectrum,
+                       std::shared_ptr<const FFTWVector> signal = nullptr);
     void recordPostprocessing();                                    // processing after recording finished
     void updateOverpull();
+    void stopPipeline();                                            // stop the consumer stages
+    void logPipelineStatistics();                                   // log the queue counters
 
     double signalPreprocessing(FFTWVector &signal);                 // Preprocessing of incoming signal
     void signalProcessing(FFTWVector &signal, int samplingrate);    // processing of the current data
-    bool detectClipping(FFTWVector signal);                         // Clipping detector, not yet implemented
+    void spectrumProcessing();                                      // processing of the current spectrum
+    bool detectClipping(const CircularBuffer<FFTWType> &buffer);    // Clipping detector
     void PerformFFT (FFTWVector &signal, FFTWVector &powerspec);    // Perform fast Fourier transformation
     void createPolygon (const FFTWVector &powerspec, FFTPolygon &poly) const;   // Create polygon for drawing
 
@@ -115,11 +158,14 @@ private:
     std::atomic<bool> mRecording;           ///< Flag indicating ongoing recording
     FFTWVector mProprocessedSignal;         ///< the current signal (after preprocessing)
     FFTDataPointer mPowerspectrum;          ///< the last recorded powerspectrum
+    std::shared_ptr<FFTWVector> mAnalysisSignal;    ///< Copy of the last signal for the zoom analysis
 
     FFT_Implementation mFFT;                ///< Instance of the Fourier transformer
+    StreamingSpectrum mStreamingSpectrum;   ///< Incremental spectrum during recording
 
     FFTAnalyzer mFFTAnalyser;               ///< Instance of the FFT analyzer
     KeyRecognizer mKeyRecognizer;           ///< Instance of the Key recognizer
+    AnalysisStage mAnalysisStage;           ///< Stage running the FFT analyzer in tuning mode
     OverpullEstimator mOverpull;            ///< Instance of the overpull estimator
     std::map<int,int> mKeyCountStatistics;  ///< Count which key is selected how often
     std::mutex mKeyCountStatisticsMutex;    ///< Corresponding mutex
@@ -0,0 +1,255 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                  Streaming power spectrum (Welch method)
+//=============================================================================
+
+#include "streamingspectrum.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "../system/log.h"
+#include "../math/mathtools.h"
+
+//-----------------------------------------------------------------------------
+//                              Constructor
+//-----------------------------------------------------------------------------
+
+StreamingSpectrum::StreamingSpectrum() :
+    mSamplingRate(0),
+    mFrameSize(0),
+    mHopSize(0),
+    mSamplesSinceFrame(0),
+    mStarted(false),
+    mFollow(0),
+    mE1(0), mE2(0), mE3(0),
+    mNumberOfFrames(0)
+{}
+
+
+//-----------------------------------------------------------------------------
+//                   Set sampling rate and frame size
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Initialize the streaming spectrum for a given sampling rate
+///
+/// The frame size is chosen as the largest power of two which does not
+/// exceed MAXIMAL_FRAME_LENGTH_IN_MILLISECONDS. The window is only
+/// recomputed if the frame size changes. Since all complete frames have the
+/// same size, the FFT plan is created once and reused afterwards. The
+/// function resets the accumulated spectrum.
+/// \param samplingRate : Sampling rate of the incoming signal
+///////////////////////////////////////////////////////////////////////////////
+
+void StreamingSpectrum::init (int samplingRate)
+{
+    EptAssert(samplingRate > 0, "Sampling rate has to be positive");
+    mSamplingRate = samplingRate;
+
+    const size_t maxsize = static_cast<size_t>(samplingRate) *
+            MAXIMAL_FRAME_LENGTH_IN_MILLISECONDS / 1000;
+    size_t framesize = 2;
+    while (2 * framesize <= maxsize) framesize *= 2;
+
+    if (framesize != mFrameSize)
+    {
+        mFrameSize = framesize;
+        mHopSize = mFrameSize / FRAME_OVERLAP;
+        mHistory.resize(mFrameSize);
+        mWindow.resize(mFrameSize);
+        for (size_t i = 0; i < mFrameSize; ++i)
+            mWindow[i] = 0.5 * (1 - cos(MathTools::TWO_PI * i / (mFrameSize - 1)));
+        mFrame.assign(mFrameSize, 0);
+        mPartialWindow.clear();
+        mPartialWindow.reserve(mFrameSize);
+    }
+    reset();
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Clear the accumulated spectrum
+//-----------------------------------------------------------------------------
+
+void StreamingSpectrum::reset()
+{
+    mHistory.clear();
+    mSamplesSinceFrame = 0;
+    mStarted = false;
+    mFollow = 0;
+    mE1 = mE2 = mE3 = 0;
+    mAccumulator.assign(mFrameSize / 2 + 1, 0);
+    mNumberOfFrames = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Process newly arrived samples
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Process newly arrived samples
+///
+/// The samples are preprocessed in the same way as the complete signal in
+/// SignalAnalyzer::signalPreprocessing, but with filters whose state is
+/// kept between successive calls. Leading zeros are discarded. Whenever
+/// mHopSize new samples have been collected, a new frame is transformed.
+/// \param packet : Vector of new PCM samples
+///////////////////////////////////////////////////////////////////////////////
+
+void StreamingSpectrum::pushSamples (const FFTWVector &packet)
+{
+    EptAssert(mFrameSize > 0, "Streaming spectrum has to be initialized");
+
+    const double a = 10.8828 * 5.0 / mSamplingRate;  // Subsonic damping factor
+    const double gamma = 50.0 / mSamplingRate;       // Energy follower rate
+
+    for (size_t i = 0; i < packet.size(); ++i)
+    {
+        double s = packet[i];
+        if (not mStarted)
+        {
+            if (s == 0) continue;
+
+            // Initial energy of the keystroke estimated from
+            // the first 0.2 seconds available in this packet
+            const size_t blocksize = std::min<size_t>(packet.size() - i, mSamplingRate / 5);
+            double E0 = 0;
+            for (size_t j = i; j < i + blocksize; ++j) E0 += packet[j] * packet[j];
+            E0 *= 2.0 / blocksize;
+            mE1 = mE2 = mE3 = E0;
+            mStarted = true;
+        }
+
+        // subsonic waves
+        mFollow += a * (s - mFollow);
+        s -= mFollow;
+
+        // constant volume
+        mE1 += gamma * (s*s - mE1);
+        mE2 += gamma * (mE1 - mE2);
+        mE3 += gamma * (mE2 - mE3);
+        s /= (sqrt(fabs(mE3)) + 0.001);
+
+        mHistory.push_back(s);
+        if (++mSamplesSinceFrame >= mHopSize and mHistory.size() == mFrameSize)
+        {
+            processFrame();
+            mSamplesSinceFrame = 0;
+        }
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Get the current spectrum
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Get the current averaged power spectrum
+///
+/// Returns the average over all complete frames. If no frame has been
+/// completed yet, the spectrum of the available samples is computed with
+/// a window covering these samples. The window is cached and only
+/// recomputed if the number of samples has changed.
+/// \return Shared pointer to a new FFTData structure, nullptr if no data.
+///////////////////////////////////////////////////////////////////////////////
+
+FFTDataPointer StreamingSpectrum::getPowerspectrum()
+{
+    if (not mStarted or mHistory.size() < 2) return nullptr;
+
+    FFTDataPointer powerspectrum = std::make_shared<FFTData>();
+    powerspectrum->samplingRate = mSamplingRate;
+
+    if (mNumberOfFrames > 0)
+    {
+        powerspectrum->fft = mAccumulator;
+        for (auto &p : powerspectrum->fft) p /= mNumberOfFrames;
+    }
+    else
+    {
+        // partial frame with a window covering the available samples only
+        const size_t N = mHistory.size();
+        if (mPartialWindow.size() != N)
+        {
+            mPartialWindow.resize(N);
+            for (size_t i = 0; i < N; ++i)
+                mPartialWindow[i] = 0.5 * (1 - cos(MathTools::TWO_PI * i / (N - 1)));
+        }
+        const double norm = transformFrame(mPartialWindow);
+        powerspectrum->fft.resize(mFramePower.size());
+        for (size_t q = 0; q < mFramePower.size(); ++q)
+            powerspectrum->fft[q] = mFramePower[q] / norm;
+    }
+    return powerspectrum;
+}
+
+
+//-----------------------------------------------------------------------------
+//                         Add a complete frame
+//-----------------------------------------------------------------------------
+
+void StreamingSpectrum::processFrame()
+{
+    const double norm = transformFrame(mWindow);
+    EptAssert(mFramePower.size() == mAccumulator.size(), "Inconsistent frame size");
+    for (size_t q = 0; q < mFramePower.size(); ++q)
+        mAccumulator[q] += mFramePower[q] / norm;
+    ++mNumberOfFrames;
+}
+
+
+//-----------------------------------------------------------------------------
+//                      Window and transform a frame
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Apply the window to the history and compute its power spectrum
+///
+/// The samples are read in place from the circular history buffer. The
+/// windowed signal is zero-padded to mFrameSize. The resulting power
+/// spectrum is stored in mFramePower.
+/// \param window : Window of the same length as the history
+/// \return Sum of the squared window weights, used for normalization
+///////////////////////////////////////////////////////////////////////////////
+
+double StreamingSpectrum::transformFrame (const FFTWVector &window)
+{
+    const CircularBuffer<FFTWType>::Segments history = mHistory.getSegments();
+    EptAssert(history.size() == window.size() and history.size() <= mFrameSize,
+              "History and window sizes do not match");
+    double norm = 0;
+    for (size_t i = 0; i < history.firstSize; ++i)
+    {
+        mFrame[i] = window[i] * history.first[i];
+        norm += window[i] * window[i];
+    }
+    for (size_t i = 0, j = history.firstSize; i < history.secondSize; ++i, ++j)
+    {
+        mFrame[j] = window[j] * history.second[i];
+        norm += window[j] * window[j];
+    }
+    std::fill(mFrame.begin() + history.size(), mFrame.end(), 0);
+    mFFT.calculatePowerspectrum(mFrame, mFramePower);
+    return norm;
+}
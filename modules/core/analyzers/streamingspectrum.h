@@ -0,0 +1,95 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                  Streaming power spectrum (Welch method)
+//=============================================================================
+
+#ifndef STREAMINGSPECTRUM_H
+#define STREAMINGSPECTRUM_H
+
+#include "prerequisites.h"
+
+#include "../audio/circularbuffer.h"
+#include "../math/fftimplementation.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Incremental power spectrum of a growing audio signal
+///
+/// While a keystroke is recorded the SignalAnalyzer has to provide preview
+/// spectra at regular intervals. Transforming the whole recorded signal
+/// each time would make the cost of every update grow with the length of
+/// the recording. Instead, this class implements Welch's method: The
+/// incoming samples are preprocessed on the fly (subsonic filter and
+/// volume normalization), cut into overlapping frames of fixed size
+/// and Hann-windowed. The power spectra of these frames are summed up in
+/// a running average. Each sample is touched only once, hence the cost per
+/// update is constant.
+///
+/// Before the first frame is complete, the spectrum of the partial frame
+/// (zero-padded to the frame size) is returned.
+///
+/// The single full-resolution FFT of the complete signal is still carried
+/// out by the SignalAnalyzer after the recording has finished.
+///////////////////////////////////////////////////////////////////////////////
+
+class EPT_EXTERN StreamingSpectrum
+{
+public:
+    static const int MAXIMAL_FRAME_LENGTH_IN_MILLISECONDS = 1500;   ///< Upper bound for the frame length
+    static const int FRAME_OVERLAP = 8;                             ///< Number of frames overlapping at a given time
+
+public:
+    StreamingSpectrum();
+    ~StreamingSpectrum() {}
+
+    void init (int samplingRate);                   // Set sampling rate and frame size
+    void reset();                                   // Clear the accumulated spectrum
+    void pushSamples (const FFTWVector &packet);    // Process newly arrived samples
+
+    /// \brief Returns true if at least one non-vanishing sample was received
+    bool hasData() const { return mStarted; }
+
+    FFTDataPointer getPowerspectrum();              // Get the current averaged spectrum
+
+private:
+    void processFrame();
+    double transformFrame (const FFTWVector &window);
+
+    int mSamplingRate;                              ///< Current sampling rate
+    size_t mFrameSize;                              ///< Number of samples per frame (power of two)
+    size_t mHopSize;                                ///< Samples between two successive frames
+    size_t mSamplesSinceFrame;                      ///< New samples since the last frame
+
+    bool mStarted;                                  ///< Flag indicating that the signal has started
+    double mFollow;                                 ///< State of the subsonic filter
+    double mE1, mE2, mE3;                           ///< State of the energy followers
+
+    CircularBuffer<FFTWType> mHistory;              ///< The last mFrameSize preprocessed samples
+    FFTWVector mWindow;                             ///< Hann window of length mFrameSize
+    FFTWVector mPartialWindow;                      ///< Hann window of the last partial frame
+    FFTWVector mFrame;                              ///< Windowed frame passed to the FFT
+    FFTWVector mFramePower;                         ///< Power spectrum of the frame
+    FFTWVector mAccumulator;                        ///< Sum of the power spectra of all frames
+    int mNumberOfFrames;                            ///< Number of accumulated frames
+
+    FFT_Implementation mFFT;                        ///< Instance of the Fourier transformer
+};
+
+#endif // STREAMINGSPECTRUM_H
@@ -0,0 +1,289 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                   Narrow-band zoom analysis of the partials
+//=============================================================================
+
+#include "zoomanalyzer.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "../system/log.h"
+#include "../system/eptexception.h"
+#include "../math/mathtools.h"
+
+const double ZoomAnalyzer::MAXIMAL_FREQUENCY = 10000;
+
+//-----------------------------------------------------------------------------
+//                              Constructor
+//-----------------------------------------------------------------------------
+
+ZoomAnalyzer::ZoomAnalyzer() :
+    mSamplingRate(0),
+    mSearchSize(0)
+{}
+
+
+//-----------------------------------------------------------------------------
+//                       Compute the tuning deviation
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Compute the tuning deviation curve of a known key
+///
+/// The partials are expected at the frequencies
+/// f_n = n f_1 sqrt((1+B n^2)/(1+B)). Partials above MAXIMAL_FREQUENCY or
+/// the Nyquist frequency are ignored.
+/// \param signal : Preprocessed audio signal
+/// \param samplingRate : Sampling rate of the signal
+/// \param frequency : Expected frequency f_1 of the fundamental in Hz
+/// \param inharmonicity : Inharmonicity coefficient B of the key
+/// \param curve : Resulting curve, normalized to a maximum of 1. Its size
+/// determines the search range in cents.
+/// \return false if there is no intensity in the bands of the partials
+///////////////////////////////////////////////////////////////////////////////
+
+bool ZoomAnalyzer::computeTuningDeviation (const FFTWVector &signal, int samplingRate,
+                                           double frequency, double inharmonicity,
+                                           TuningDeviationCurveType &curve)
+{
+    EptAssert(samplingRate > 0, "Sampling rate has to be positive");
+    EptAssert(curve.size() > 0, "The size of the curve has to be set");
+    mSamplingRate = samplingRate;
+    mSearchSize = static_cast<int>(curve.size());
+    std::fill(curve.begin(), curve.end(), 0);
+    const size_t N = signal.size();
+    if (N < 2 or frequency <= 0) return false;
+
+    // Hann window, recomputed only if the length of the signal changes
+    if (mWindow.size() != N)
+    {
+        mWindow.resize(N);
+        for (size_t i = 0; i < N; ++i)
+            mWindow[i] = 0.5 * (1 - cos(MathTools::TWO_PI * i / (N - 1)));
+    }
+
+    // Half width of the band around each partial relative to its frequency
+    const double halfWidth = pow(2.0, (mSearchSize / 2 + 1) / 1200.0) - 1;
+    const double B = std::max(0.0, inharmonicity);
+    const double fmax = std::min(MAXIMAL_FREQUENCY, 0.5 * samplingRate);
+
+    for (int n = 1; n <= NUMBER_OF_PARTIALS; ++n)
+    {
+        const double f = frequency * n * sqrt((1 + B * n * n) / (1 + B));
+        if (f * (1 + halfWidth) > fmax) break;
+
+        // Decimation such that the decimated sampling rate covers the band
+        const int decimation = std::max(1, static_cast<int>(
+                    samplingRate / (OVERSAMPLING * halfWidth * f)));
+        mixDown(signal, f, decimation);
+        if (mBaseband.size() < 2) break;
+
+        // Natural resolution of the signal in cents at the lower band edge
+        const double resolution = 1200 / MathTools::LOG2 * samplingRate /
+                static_cast<double>(N) / (f / (1 + halfWidth));
+
+        mBand.assign(mSearchSize, 0);
+        if (resolution >= 2) evaluateDirectly(f, decimation);
+        else evaluateByFFT(f, decimation);
+        for (int i = 0; i < mSearchSize; ++i) curve[i] += mBand[i];
+    }
+
+    const double maximum = *std::max_element(curve.begin(), curve.end());
+    if (maximum < 1E-15) return false;
+    for (auto &element : curve) element /= maximum;
+    return true;
+}
+
+
+//-----------------------------------------------------------------------------
+//                  Heterodyning, low-pass filter, decimation
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Shift a partial to zero frequency and decimate the signal
+///
+/// The windowed signal is multiplied by exp(-2 pi i f t). The product is
+/// summed over triangular blocks of length 2D which overlap by D samples.
+/// Since the weights of overlapping triangles add up to one, the decimated
+/// signal carries the full intensity of the band. The triangular shape
+/// suppresses frequencies aliasing into the band by a second-order zero.
+///
+/// The sums are computed blockwise from the plain sum and the sum weighted
+/// by the position in the block, so that each sample is touched only once.
+/// The phasor is advanced by a complex rotation and renormalized after
+/// each block.
+/// \param signal : Preprocessed audio signal
+/// \param frequency : Frequency of the partial in Hz
+/// \param decimation : Decimation factor D
+///////////////////////////////////////////////////////////////////////////////
+
+void ZoomAnalyzer::mixDown (const FFTWVector &signal, double frequency, int decimation)
+{
+    const size_t D = static_cast<size_t>(decimation);
+    const size_t blocks = signal.size() / D;
+    mBaseband.clear();
+    if (blocks < 2) return;
+    mBaseband.resize(blocks - 1);
+
+    const double omega = MathTools::TWO_PI * frequency / mSamplingRate;
+    const double cr = cos(omega), ci = -sin(omega);
+    double pr = 1, pi = 0;
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        const FFTWType *x = signal.data() + b * D;
+        const double *w = mWindow.data() + b * D;
+        double sr = 0, si = 0, rr = 0, ri = 0;
+        for (size_t j = 0; j < D; ++j)
+        {
+            const double y = w[j] * x[j];
+            const double yr = y * pr, yi = y * pi;
+            sr += yr; si += yi;
+            rr += j * yr; ri += j * yi;
+            const double t = pr * cr - pi * ci;
+            pi = pr * ci + pi * cr;
+            pr = t;
+        }
+        const double norm = 1.0 / sqrt(pr * pr + pi * pi);
+        pr *= norm; pi *= norm;
+
+        // rising edge of the triangle of this block, falling edge of the previous one
+        if (b + 1 < blocks) mBaseband[b] = Complex(rr + sr, ri + si) / static_cast<double>(D);
+        if (b > 0) mBaseband[b - 1] += Complex((D - 1) * sr - rr, (D - 1) * si - ri) / static_cast<double>(D);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                   Attenuation of the triangular filter
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Power attenuation of the decimation filter
+/// \param shift : Frequency shift relative to the partial in Hz
+/// \param decimation : Decimation factor D
+/// \return Ratio of the transmitted power, 1 for zero shift
+///////////////////////////////////////////////////////////////////////////////
+
+double ZoomAnalyzer::getDroop (double shift, int decimation) const
+{
+    const double x = MathTools::PI * shift / mSamplingRate;
+    const double denominator = decimation * sin(x);
+    if (fabs(denominator) < 1E-12) return 1;
+    const double amplitude = pow(sin(decimation * x) / denominator, 2);
+    return amplitude * amplitude;
+}
+
+
+//-----------------------------------------------------------------------------
+//               Direct evaluation of the spectrum on a cent grid
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Evaluate the spectrum of the decimated signal at each cent
+///
+/// Used if the spectral peaks are broad compared to a cent. The Fourier sum
+/// is evaluated by the Horner scheme.
+/// \param frequency : Frequency of the partial in Hz
+/// \param decimation : Decimation factor D
+///////////////////////////////////////////////////////////////////////////////
+
+void ZoomAnalyzer::evaluateDirectly (double frequency, int decimation)
+{
+    const int M = static_cast<int>(mBaseband.size());
+    for (int i = 0; i < mSearchSize; ++i)
+    {
+        const double shift = frequency * (pow(2.0, (i - mSearchSize / 2) / 1200.0) - 1);
+        const double phi = -MathTools::TWO_PI * shift * decimation / mSamplingRate;
+        const double qr = cos(phi), qi = sin(phi);
+        double xr = 0, xi = 0;
+        for (int m = M - 1; m >= 0; --m)
+        {
+            const double t = xr * qr - xi * qi + mBaseband[m].real();
+            xi = xr * qi + xi * qr + mBaseband[m].imag();
+            xr = t;
+        }
+        mBand[i] = (xr * xr + xi * xi) / getDroop(shift, decimation);
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                Evaluation of the spectrum by a short FFT
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Evaluate the spectrum of the decimated signal by FFT
+///
+/// Used if the spectral peaks are narrower than a few cents. The decimated
+/// signal is zero-padded such that the spectrum is sampled at least twice
+/// per cent. The complex transform is composed of the real transforms of
+/// the real and the imaginary part. Each cent bin takes the maximum of the
+/// samples falling into it.
+/// \param frequency : Frequency of the partial in Hz
+/// \param decimation : Decimation factor D
+///////////////////////////////////////////////////////////////////////////////
+
+void ZoomAnalyzer::evaluateByFFT (double frequency, int decimation)
+{
+    const size_t M = mBaseband.size();
+    const double rate = static_cast<double>(mSamplingRate) / decimation;
+    const double lowest = frequency * pow(2.0, -(mSearchSize / 2 + 1) / 1200.0);
+    const double required = rate * 2400 / MathTools::LOG2 / lowest;
+    const size_t Nz = FFT_Implementation::getFastSize(
+                std::max(M, static_cast<size_t>(ceil(required))));
+
+    mReal.assign(Nz, 0);
+    mImag.assign(Nz, 0);
+    for (size_t m = 0; m < M; ++m)
+    {
+        mReal[m] = static_cast<FFTRealType>(mBaseband[m].real());
+        mImag[m] = static_cast<FFTRealType>(mBaseband[m].imag());
+    }
+    mFFT.calculateFFT(mReal, mRealFFT);
+    mFFT.calculateFFT(mImag, mImagFFT);
+
+    // Z[k] = A[k] + i B[k] with A[-k] = conj(A[k]) for real input
+    auto transform = [this, Nz] (long k) -> Complex
+    {
+        const bool negative = (k < 0);
+        const size_t index = static_cast<size_t>(negative ? -k : k);
+        Complex a(mRealFFT[index].real(), mRealFFT[index].imag());
+        Complex b(mImagFFT[index].real(), mImagFFT[index].imag());
+        if (negative) { a = std::conj(a); b = std::conj(b); }
+        return a + Complex(0, 1) * b;
+    };
+
+    const double highest = frequency * pow(2.0, (mSearchSize / 2 + 1) / 1200.0);
+    const long kmin = std::max(-static_cast<long>((Nz - 1) / 2),
+                               static_cast<long>(floor((lowest - frequency) * Nz / rate)));
+    const long kmax = std::min(static_cast<long>(Nz / 2),
+                               static_cast<long>(ceil((highest - frequency) * Nz / rate)));
+    for (long k = kmin; k <= kmax; ++k)
+    {
+        const double shift = k * rate / Nz;
+        const double cents = 1200 * log((frequency + shift) / frequency) / MathTools::LOG2;
+        const int i = MathTools::roundToInteger(cents) + mSearchSize / 2;
+        if (i < 0 or i >= mSearchSize) continue;
+        const double power = std::norm(transform(k)) / getDroop(shift, decimation);
+        mBand[i] = std::max(mBand[i], power);
+    }
+}
@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                   Narrow-band zoom analysis of the partials
+//=============================================================================
+
+#ifndef ZOOMANALYZER_H
+#define ZOOMANALYZER_H
+
+#include <complex>
+
+#include "prerequisites.h"
+#include "fftanalyzererrorcodes.h"
+#include "../math/fftimplementation.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Narrow-band analysis of the partials of a known key
+///
+/// In the tuning mode the frequency of the selected key is only needed in
+/// a range of about a semitone around its expected value. Instead of
+/// analyzing the full spectrum, this class evaluates only the narrow bands
+/// around the first partials of the key (zoom FFT):
+///
+/// 1. The Hann-windowed signal is shifted in frequency such that the
+///    expected partial lies at zero (complex heterodyning).
+/// 2. The shifted signal is low-pass filtered and decimated by summing
+///    over overlapping triangular blocks. The decimated sampling rate is
+///    a multiple of the bandwidth of interest.
+/// 3. The spectrum of the short decimated signal is evaluated on a grid of
+///    one cent, either directly (if the peaks are broad compared to a
+///    cent) or by an FFT which resolves the natural frequency resolution
+///    of the signal. In the latter case the maximum within each cent is
+///    taken.
+///
+/// The power of all partials, shifted by the same number of cents, is
+/// summed up. The resulting curve has the same form as the tuning
+/// deviation curve of the FFTAnalyzer: Bin i corresponds to a shift of
+/// i-searchSize/2 cents relative to the given fundamental frequency.
+///
+/// Compared to the transformation and logarithmic binning of the full
+/// spectrum, the cost is dominated by the heterodyning which is linear in
+/// the length of the signal. Since the spectrum is evaluated directly
+/// at the frequencies of interest, the resolution is not limited by the
+/// bin size of a full-band FFT.
+///////////////////////////////////////////////////////////////////////////////
+
+class EPT_EXTERN ZoomAnalyzer
+{
+public:
+    static const int NUMBER_OF_PARTIALS = 6;        ///< Maximal number of analyzed partials
+    static const int OVERSAMPLING = 8;              ///< Decimated sampling rate per half bandwidth
+    static const double MAXIMAL_FREQUENCY;          ///< Upper bound for the analyzed partials
+
+public:
+    ZoomAnalyzer();
+    ~ZoomAnalyzer() {}
+
+    bool computeTuningDeviation (const FFTWVector &signal, int samplingRate,
+                                 double frequency, double inharmonicity,
+                                 TuningDeviationCurveType &curve);
+
+private:
+    using Complex = std::complex<double>;
+
+    void mixDown (const FFTWVector &signal, double frequency, int decimation);
+    void evaluateDirectly (double frequency, int decimation);
+    void evaluateByFFT (double frequency, int decimation);
+    double getDroop (double shift, int decimation) const;
+
+    int mSamplingRate;                  ///< Sampling rate of the current signal
+    int mSearchSize;                    ///< Number of bins of the curve (cents)
+    std::vector<double> mWindow;        ///< Hann window of the length of the signal
+    std::vector<Complex> mBaseband;     ///< Decimated signal of the current partial
+    std::vector<double> mBand;          ///< Power of the current partial per cent
+    FFT_Implementation mFFT;            ///< Instance of the Fourier transformer
+    FFTRealVector mReal;                ///< Real part of the decimated signal
+    FFTRealVector mImag;                ///< Imaginary part of the decimated signal
+    FFTComplexVector mRealFFT;          ///< Fourier transform of the real part
+    FFTComplexVector mImagFFT;          ///< Fourier transform of the imaginary part
+};
+
+#endif // ZOOMANALYZER_H
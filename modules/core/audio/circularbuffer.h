@@ -40,7 +40,10 @@
 /// in order to keep the maximum size constant.
 ///
 /// The current content of the buffer can be retrieved as a time-ordered vector
-/// by calling the function getOrderedData().
+/// by calling the function getOrderedData(). Since this function allocates
+/// a new vector, time-critical code should either copy the data into an
+/// existing buffer by calling copyOrderedData() or read the data directly
+/// from the two contiguous segments of the ring returned by getSegments().
 ///
 /// The circular buffer is used by the AudioRecorder and the SignalAnalyzer.
 ///
@@ -51,6 +54,27 @@
 template <class data_type>
 class CircularBuffer
 {
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Read-only view of the buffer content without copying.
+    ///
+    /// The time-ordered data consists of the older segment followed by
+    /// the newer segment. The view is invalidated by any modification
+    /// of the buffer.
+    ///////////////////////////////////////////////////////////////////////////
+    struct Segments
+    {
+        const data_type *first;                     ///< Pointer to the older segment
+        std::size_t firstSize;                      ///< Number of elements in the older segment
+        const data_type *second;                    ///< Pointer to the newer segment
+        std::size_t secondSize;                     ///< Number of elements in the newer segment
+
+        std::size_t size() const
+            {return firstSize + secondSize;}        ///< Total number of elements
+        const data_type &operator[] (std::size_t i) const
+            {return i < firstSize ? first[i] : second[i - firstSize];} ///< Element access
+    };
+
 public:
     CircularBuffer(std::size_t maximum_size = 0);   ///< Construct an empty buffer of maximal size zero
 
@@ -58,6 +82,10 @@ public:
     void push_back(const data_type &data);          ///< Append a new data element to the buffer
     void resize(std::size_t maximum_size);          ///< Resize the buffer, shrink oldest data if necessary
     std::vector<data_type> getOrderedData() const;  ///< Copy entire data in a time-ordered form
+    Segments getSegments() const;                   ///< Access the data in place as two segments
+    void copyOrderedData(data_type *dest) const;    ///< Copy entire data into a caller-provided buffer
+    template <class allocator_type>
+    void copyOrderedData(std::vector<data_type, allocator_type> &dest) const; ///< Copy entire data into an existing vector
     std::vector<data_type> readData(size_t n);      ///< Retrieve time-ordeded data with maximum size of n and remove if from the buffer
     std::size_t size() const {return mCurrentSize;} ///< Return current buffer size
     std::size_t maximum_size() const
@@ -158,18 +186,77 @@ template <class data_type>
 std::vector<data_type> CircularBuffer<data_type>::getOrderedData() const
 {
     std::vector<data_type> data_out(mCurrentSize);
-    // copy end
-    std::size_t part1Size = std::min(mCurrentReadPosition + mCurrentSize, mMaximumSize) - mCurrentReadPosition;
-    std::memcpy(data_out.data(), mData.data() + mCurrentReadPosition, part1Size * sizeof(data_type));
+    copyOrderedData(data_out.data());
+    return data_out;
+}
 
-    // copy start
-    std::size_t part2Size = mCurrentSize - part1Size;
-    std::memcpy(data_out.data() + part1Size, mData.data(), part2Size * sizeof(data_type));
 
-    return data_out;
+//-----------------------------------------------------------------------------
+//                    Access the data in place as two segments
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function returns pointers to the two contiguous parts of the
+/// internal ring, the older one first. No data is copied. The returned
+/// pointers are only valid as long as the buffer is not modified.
+///
+/// \return Segments structure describing the data
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+typename CircularBuffer<data_type>::Segments CircularBuffer<data_type>::getSegments() const
+{
+    Segments segments;
+    // end of the ring
+    segments.first = mData.data() + mCurrentReadPosition;
+    segments.firstSize = std::min(mCurrentReadPosition + mCurrentSize, mMaximumSize) - mCurrentReadPosition;
+    // start of the ring
+    segments.second = mData.data();
+    segments.secondSize = mCurrentSize - segments.firstSize;
+    return segments;
 }
 
 
+//-----------------------------------------------------------------------------
+//                 Copy data into a caller-provided buffer
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function copies the time-ordered data into a buffer provided by the
+/// caller, for example an aligned buffer used for the FFT. The data will
+/// NOT be removed from the buffer.
+///
+/// \param dest : Pointer to a memory area holding at least size() elements.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+void CircularBuffer<data_type>::copyOrderedData(data_type *dest) const
+{
+    const Segments segments = getSegments();
+    if (segments.firstSize > 0)
+        std::memcpy(dest, segments.first, segments.firstSize * sizeof(data_type));
+    if (segments.secondSize > 0)
+        std::memcpy(dest + segments.firstSize, segments.second, segments.secondSize * sizeof(data_type));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function copies the time-ordered data into an existing vector which
+/// is resized accordingly. In contrast to getOrderedData() the memory of the
+/// vector is reused if its capacity is sufficient. The vector may use any
+/// allocator, e.g. the aligned allocator of the FFT vectors.
+///
+/// \param dest : Vector receiving the data.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+template <class allocator_type>
+void CircularBuffer<data_type>::copyOrderedData(std::vector<data_type, allocator_type> &dest) const
+{
+    dest.resize(mCurrentSize);
+    copyOrderedData(dest.data());
+}
+
 
 //-----------------------------------------------------------------------------
 //  Retrieve time-ordeded data with max size of n and remove if from the buffer
@@ -184,13 +271,16 @@ std::vector<data_type> CircularBuffer<data_type>::getOrderedData() const
 template <class data_type>
 std::vector<data_type> CircularBuffer<data_type>::readData(size_t n)
 {
-    std::vector<data_type> data_out(std::move(getOrderedData()));
-    if (data_out.size() > n) data_out.resize(n);
+    const Segments segments = getSegments();
+    std::vector<data_type> data_out(std::min(n, mCurrentSize));
+    const std::size_t part1Size = std::min(segments.firstSize, data_out.size());
+    std::memcpy(data_out.data(), segments.first, part1Size * sizeof(data_type));
+    std::memcpy(data_out.data() + part1Size, segments.second, (data_out.size() - part1Size) * sizeof(data_type));
 
     EptAssert(mCurrentSize >= data_out.size(), "Do not read more data than existent.");
 
     // reset read position
-    mCurrentReadPosition = (mCurrentReadPosition + data_out.size()) % mMaximumSize;
+    if (mMaximumSize > 0) mCurrentReadPosition = (mCurrentReadPosition + data_out.size()) % mMaximumSize;
     mCurrentSize = mCurrentSize - data_out.size();
 
     return data_out;
@@ -211,24 +301,21 @@ std::vector<data_type> CircularBuffer<data_type>::readData(size_t n)
 template <class data_type>
 void CircularBuffer<data_type>::resize(std::size_t maximum_size)
 {
-    // we have to temporarily store the old data and rewrite at at position 0
-    std::vector<data_type> old_data(std::move(getOrderedData()));
+    // rotate the data in place so that the oldest element is at position 0
+    std::rotate(mData.begin(), mData.begin() + mCurrentReadPosition, mData.end());
+    // new current size is size of old data, or smaller
+    const std::size_t newSize = std::min(mCurrentSize, maximum_size);
+    // move the newest data to the front if the buffer shrinks
+    if (newSize < mCurrentSize)
+        std::move(mData.begin() + (mCurrentSize - newSize), mData.begin() + mCurrentSize, mData.begin());
+    mCurrentSize = newSize;
     mMaximumSize = maximum_size;
-    // new current size is size of old data, or smaller)
-    mCurrentSize = std::min(old_data.size(), maximum_size);
     // resize or internal data structure
     mData.resize(mMaximumSize);
 
-    // dont copy data if new buffer is empty
-    if (mMaximumSize == 0) return;
-
     // reset read and write pointers
     mCurrentReadPosition = 0;
-    mCurrentWritePosition = mCurrentSize % mMaximumSize;
-    // copy the old data
-    std::memcpy(mData.data(),
-                old_data.data() + (old_data.size() - mCurrentSize),
-                mCurrentSize * sizeof(data_type));
+    mCurrentWritePosition = (mMaximumSize == 0) ? 0 : mCurrentSize % mMaximumSize;
 }
 
 //-----------------------------------------------------------------------------
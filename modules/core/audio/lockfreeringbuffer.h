@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                  Lock-free single-producer ring buffer
+//=============================================================================
+
+#ifndef LOCKFREERINGBUFFER_H
+#define LOCKFREERINGBUFFER_H
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "prerequisites.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Ring buffer connecting one producer thread with one consumer thread
+///
+/// In contrast to the CircularBuffer this container can be written and read
+/// simultaneously from two different threads without any locking. It is
+/// meant for passing PCM data out of the audio callback, where waiting for
+/// a mutex has to be avoided. Exactly one thread may call push() and
+/// exactly one other thread may call pop() and discard().
+///
+/// The read and write counters increase monotonically, their difference
+/// is the number of waiting elements. The capacity is a power of two so
+/// that the position in the ring is obtained by a bit mask. If the buffer
+/// is full, push() does not overwrite old data but drops the new elements.
+///
+/// This class contains of a header file only. There is no corresponding
+/// implementation (cpp) file.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+class LockFreeRingBuffer
+{
+public:
+    LockFreeRingBuffer(std::size_t minimal_capacity);      ///< Construct an empty buffer
+
+    std::size_t push(const data_type *data, std::size_t n); ///< Append up to n elements (producer)
+    std::size_t pop(data_type *data, std::size_t n);        ///< Remove up to n elements (consumer)
+    void discard();                                         ///< Remove all waiting elements (consumer)
+    std::size_t capacity() const {return mData.size();}     ///< Return the capacity
+    std::size_t size() const;                               ///< Return the number of waiting elements
+
+private:
+    static std::size_t getPowerOfTwo(std::size_t n)
+    { std::size_t p = 1; while (p < n) p *= 2; return p; }  ///< Smallest power of two >= n
+
+    std::vector<data_type> mData;                   ///< Internal cyclic data buffer
+    const std::size_t mMask;                        ///< Bit mask for the position in the ring
+    std::atomic<std::size_t> mWriteCounter;         ///< Total number of written elements
+    std::atomic<std::size_t> mReadCounter;          ///< Total number of read elements
+};
+
+//=============================================================================
+//   Lock-free ring buffer implementation (contained in header because of template)
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+//                              Constructor
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// The capacity is rounded up to the next power of two.
+/// \param minimal_capacity : Minimal number of elements the buffer can hold
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+LockFreeRingBuffer<data_type>::LockFreeRingBuffer(std::size_t minimal_capacity)
+    : mData(getPowerOfTwo(minimal_capacity)),
+      mMask(mData.size() - 1),
+      mWriteCounter(0),
+      mReadCounter(0)
+{}
+
+
+//-----------------------------------------------------------------------------
+//                         Append new elements
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function may only be called by the producer thread. The elements
+/// are published to the consumer after they have been written.
+/// \param data : Pointer to the new elements
+/// \param n : Number of new elements
+/// \return Number of elements actually written, smaller than n if the
+/// buffer is full
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+std::size_t LockFreeRingBuffer<data_type>::push(const data_type *data, std::size_t n)
+{
+    const std::size_t write = mWriteCounter.load(std::memory_order_relaxed);
+    const std::size_t read = mReadCounter.load(std::memory_order_acquire);
+    n = std::min(n, mData.size() - (write - read));
+    for (std::size_t i = 0; i < n; ++i) mData[(write + i) & mMask] = data[i];
+    mWriteCounter.store(write + n, std::memory_order_release);
+    return n;
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Remove waiting elements
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function may only be called by the consumer thread. It copies the
+/// oldest waiting elements and removes them from the buffer.
+/// \param data : Pointer to a memory area holding at least n elements
+/// \param n : Maximal number of elements to be read
+/// \return Number of elements actually read
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+std::size_t LockFreeRingBuffer<data_type>::pop(data_type *data, std::size_t n)
+{
+    const std::size_t read = mReadCounter.load(std::memory_order_relaxed);
+    const std::size_t write = mWriteCounter.load(std::memory_order_acquire);
+    n = std::min(n, write - read);
+    for (std::size_t i = 0; i < n; ++i) data[i] = mData[(read + i) & mMask];
+    mReadCounter.store(read + n, std::memory_order_release);
+    return n;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function may be called by both threads. The result is only a
+/// snapshot, since the other thread may change the number concurrently.
+/// \return Number of waiting elements
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+std::size_t LockFreeRingBuffer<data_type>::size() const
+{
+    const std::size_t read = mReadCounter.load(std::memory_order_acquire);
+    const std::size_t write = mWriteCounter.load(std::memory_order_acquire);
+    return write - read;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// This function may only be called by the consumer thread. It removes all
+/// elements which have been written so far.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class data_type>
+void LockFreeRingBuffer<data_type>::discard()
+{
+    mReadCounter.store(mWriteCounter.load(std::memory_order_acquire),
+                       std::memory_order_release);
+}
+
+#endif // LOCKFREERINGBUFFER_H
@@ -242,7 +242,8 @@ void SoundGenerator::handleMessage(MessagePtr m)
             if (mOperationMode==MODE_CALCULATION)
             {
                 auto message(std::static_pointer_cast<MessageChangeTuningCurve>(m));
-                preCalculateSoundOfKey(message->getKeyNumber());
+                for (auto &change : message->getFrequencies())
+                    preCalculateSoundOfKey(change.first);
             }
         }
         break;
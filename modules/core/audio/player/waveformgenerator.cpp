@@ -241,7 +241,9 @@ void WaveformGenerator::workerFunction()
                         mIn[k] = exp(phase) * intensity;
                     }
                 }
-                mFFT.calculateFFT(mIn,mOut);
+                // mIn is aligned and rebuilt for each waveform, hence it
+                // can be transformed in place without a local copy
+                mFFT.calculateFFT(mIn.data(),mOut.data(),mOut.size());
                 mLibraryMutex[keynumber].lock();
                 for (size_t i=0; i<mOut.size(); i++) mLibrary[keynumber][i]=mOut[i];
                 mLibraryMutex[keynumber].unlock();
@@ -164,7 +164,7 @@ void AudioRecorder::setMuted (bool muted)
 void AudioRecorder::readAll(PacketType &packet)
 {
     std::lock_guard<std::mutex> lock(mCurrentPacketMutex);   // lock the function
-    packet = mCurrentPacket.getOrderedData();               // copy the content
+    mCurrentPacket.copyOrderedData(packet);                 // copy the content
     mCurrentPacket.clear();                                 // clear audio buffer
 }
 
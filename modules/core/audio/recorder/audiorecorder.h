@@ -23,6 +23,7 @@
 #include "prerequisites.h"
 #include "../pcmdevice.h"
 #include "../circularbuffer.h"
+#include "../../math/fftadapter.h"
 #include "stroboscope.h"
 //#include "../../messages/messagelistener.h"
 
@@ -48,11 +49,12 @@ class EPT_EXTERN AudioRecorder : public PCMDevice
 {
 public:
     /// Floating point data type for a single PCM Value. The PCM values are
-    /// assumed to be in [-1,1].
-    typedef double PCMDataType;
+    /// assumed to be in [-1,1]. The type coincides with the data type of the
+    /// FFT, i.e., it is float if CONFIG_SINGLE_PRECISION_FFT is set.
+    typedef FFTWType PCMDataType;
 
-    /// Type definition of a PCM packet (vector of PCM values).
-    typedef std::vector<PCMDataType> PacketType;
+    /// Type definition of a PCM packet (aligned vector of PCM values).
+    typedef FFTWVector PacketType;
 
     // Static constants, explained in the source file:
 
@@ -41,18 +41,61 @@ Stroboscope::Stroboscope(AudioRecorder *recorder) :
     mRecorder(recorder),
     mActive(false),
     mSamplesPerFrame(22050),
-    mSampleCounter(0),
-    mMaxAmplitude(1E-21)
+    mSampleCounter(22050),
+    mMaxAmplitude(1E-21),
+    mBuffer(BUFFER_SIZE),
+    mPacket(BLOCK_SIZE),
+    mBlock(BLOCK_SIZE)
 {
 }
 
 
+//-----------------------------------------------------------------------------
+//                      Start and stop the stroboscope
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Start the stroboscope and its worker thread
+///
+/// The worker is only started if it is not already running.
+///////////////////////////////////////////////////////////////////////////////
+
+void Stroboscope::start()
+{
+    mActive = true;
+    if (not isThreadRunning()) SimpleThreadHandler::start();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Stop the stroboscope and wait for its worker thread
+///////////////////////////////////////////////////////////////////////////////
+
+void Stroboscope::stop()
+{
+    mActive = false;
+    {
+        std::lock_guard<std::mutex> lock (mWakeUpMutex);
+        setCancelThread(true);
+    }
+    mWakeUp.notify_one();
+    SimpleThreadHandler::stop();
+}
+
+
 //-----------------------------------------------------------------------------
 //   push raw PCM data to the stroboscope (called by AudioRecorderAdapter)
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Stroboscope::pushRawData
+///
+/// This function is called from the audio callback. It only copies the
+/// data into the lock-free ring buffer and wakes up the worker. In order
+/// not to block the audio callback, the mutex of the wake-up condition is
+/// not locked here. A wake-up which is lost in this way only delays the
+/// worker until its maximal idle time has elapsed. If the worker falls
+/// behind and the buffer is full, the data is dropped.
 /// \param data
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -61,31 +104,126 @@ void Stroboscope::pushRawData (const PacketType &data)
     // data packet size is typically 1100, can be 0.
     if (mActive) if (Settings::getSingleton().isStroboscopeActive())
     {
+        if (mBuffer.push(data.data(), data.size()) > 0) mWakeUp.notify_one();
+    }
+}
+
+
+//-----------------------------------------------------------------------------
+//                            Worker function
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Stroboscope::workerFunction
+///
+/// Reads the PCM data from the ring buffer in blocks of at most BLOCK_SIZE
+/// samples. The blocks are cut at the end of each frame. If the buffer is
+/// empty, the worker waits until it is woken up by pushRawData or stop.
+///////////////////////////////////////////////////////////////////////////////
+
+void Stroboscope::workerFunction()
+{
+    setThreadName("Stroboscope");
+    mBuffer.discard();
+    while (not cancelThread())
+    {
+        const int n = static_cast<int>(mBuffer.pop(mPacket.data(), BLOCK_SIZE));
+        if (n == 0)
+        {
+            std::unique_lock<std::mutex> lock (mWakeUpMutex);
+            mWakeUp.wait_for(lock, std::chrono::milliseconds(MAXIMAL_IDLE_TIME_IN_MILLISECONDS),
+                             [this] { return cancelThread() or mBuffer.size() > 0; });
+            continue;
+        }
+        std::copy(mPacket.begin(), mPacket.begin() + n, mBlock.begin());
+
         std::lock_guard<std::mutex> lock (mMutex);
-        for (auto &pcm : data)
+        int processed = 0;
+        while (processed < n)
         {
-            if (fabs(pcm)>mMaxAmplitude) mMaxAmplitude=fabs(pcm);
-            if (mMaxAmplitude < 1E-20) continue;
+            const int size = std::min(n - processed, std::max(mSampleCounter, 1));
+            processBlock(mBlock.data() + processed, size);
+            processed += size;
+            mSampleCounter -= size;
+            if (mSampleCounter <= 0) publishFrame();
+        }
+    }
+}
 
-            int N = static_cast<int>(mComplexPhase.size());
+
+//-----------------------------------------------------------------------------
+//                        Process a block of samples
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Convolve a block of PCM data with the rotating complex numbers
+///
+/// The complex numbers are initialized from the exact phases and rotated
+/// within the block in single precision. The loop over the partials is
+/// the innermost loop, allowing the compiler to vectorize it. The sums
+/// over the block are normalized by the sliding amplitude and added to
+/// the phase average.
+/// \param pcm : Pointer to the PCM data
+/// \param n : Number of samples in the block
+///////////////////////////////////////////////////////////////////////////////
+
+void Stroboscope::processBlock (const float *pcm, int n)
+{
+    for (int j=0; j<n; ++j)
+        if (fabs(pcm[j])>mMaxAmplitude) mMaxAmplitude=fabs(pcm[j]);
+
+    const int N = static_cast<int>(mPhase.size());
+    if (mMaxAmplitude >= 1E-20 and N > 0)
+    {
+        float *pr = mPhasorRe.data(), *pi = mPhasorIm.data();
+        float *sr = mSumRe.data(), *si = mSumIm.data();
+        const float *rr = mRotationRe.data(), *ri = mRotationIm.data();
+        for (int i=0; i<N; ++i)
+        {
+            pr[i] = static_cast<float>(cos(mPhase[i]));
+            pi[i] = static_cast<float>(sin(mPhase[i]));
+            sr[i] = si[i] = 0;
+        }
+        for (int j=0; j<n; ++j)
+        {
+            const float x = pcm[j];
             for (int i=0; i<N; ++i)
             {
-                mComplexPhase[i] *= mComplexIncrement[i];
-                mMeanComplexPhase[i] += mComplexPhase[i] * pcm / mMaxAmplitude;
-            }
-            if (mSampleCounter-- <= 0)
-            {
-                for (auto &c : mComplexPhase) c /= std::abs(c);
-                ComplexVector normalizedPhases (mMeanComplexPhase);
-                for (auto &c : normalizedPhases) c /= 0.5*mSamplesPerFrame/(1-FRAME_DAMPING);
-                MessageHandler::sendUnique<MessageStroboscope>(normalizedPhases);
-
-                for (auto &c : mMeanComplexPhase) c *= FRAME_DAMPING;
-                mMaxAmplitude *= AMPLITUDE_DAMPING;
-                mSampleCounter = mSamplesPerFrame;
+                const float re = pr[i] * rr[i] - pi[i] * ri[i];
+                const float im = pr[i] * ri[i] + pi[i] * rr[i];
+                pr[i] = re;
+                pi[i] = im;
+                sr[i] += x * re;
+                si[i] += x * im;
             }
         }
+        for (int i=0; i<N; ++i)
+            mMeanComplexPhase[i] += Complex(sr[i], si[i]) / mMaxAmplitude;
     }
+
+    // advance the exact phases
+    for (int i=0; i<N; ++i)
+        mPhase[i] = fmod(mPhase[i] + n * mPhaseIncrement[i], MathTools::TWO_PI);
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Publish a completed frame
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Send the phase average of the completed frame to the drawer
+///////////////////////////////////////////////////////////////////////////////
+
+void Stroboscope::publishFrame ()
+{
+    ComplexVector normalizedPhases (mMeanComplexPhase);
+    for (auto &c : normalizedPhases) c /= 0.5*mSamplesPerFrame/(1-FRAME_DAMPING);
+    MessageHandler::sendUnique<MessageStroboscope>(normalizedPhases);
+
+    for (auto &c : mMeanComplexPhase) c *= FRAME_DAMPING;
+    mMaxAmplitude *= AMPLITUDE_DAMPING;
+    mSampleCounter = mSamplesPerFrame;
 }
 
 
@@ -116,13 +254,21 @@ void Stroboscope::setFramesPerSecond (double fps)
 void Stroboscope::setFrequencies(const std::vector<double> &frequencies)
 {
     std::lock_guard<std::mutex> lock (mMutex);
-    mComplexPhase.resize(frequencies.size());
-    mComplexPhase.assign(frequencies.size(),1);
-    mMeanComplexPhase.resize(frequencies.size());
-    mMeanComplexPhase.assign(frequencies.size(),0);
-    mComplexIncrement.clear();
+    const size_t N = frequencies.size();
+    mPhase.assign(N,0);
+    mMeanComplexPhase.assign(N,0);
+    mPhaseIncrement.clear();
+    mRotationRe.clear();
+    mRotationIm.clear();
     for (auto &f : frequencies)
-        mComplexIncrement.push_back(std::exp(Complex(0,MathTools::TWO_PI) *
-                                    (f/mRecorder->getSampleRate())));
+    {
+        const double omega = MathTools::TWO_PI * f / mRecorder->getSampleRate();
+        mPhaseIncrement.push_back(omega);
+        mRotationRe.push_back(static_cast<float>(cos(omega)));
+        mRotationIm.push_back(static_cast<float>(sin(omega)));
+    }
+    mPhasorRe.resize(N);
+    mPhasorIm.resize(N);
+    mSumRe.resize(N);
+    mSumIm.resize(N);
 }
-
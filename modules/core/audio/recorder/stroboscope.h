@@ -30,6 +30,12 @@
 #include <complex>
 #include <vector>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "../../math/fftadapter.h"
+#include "../../system/simplethreadhandler.h"
+#include "../lockfreeringbuffer.h"
 
 class AudioRecorder;
 
@@ -58,15 +64,33 @@ class AudioRecorder;
 ///
 /// The TuningIndicatorDrawer listens to these messages and draws horizontal
 /// bars with phase-shifted rainbow colors.
+///
+/// Since pushRawData is called from the audio callback, it only copies the
+/// PCM data into a lock-free ring buffer and wakes up a separate worker
+/// thread, which processes the samples in blocks. The rotating complex numbers are
+/// stored as separate arrays of real and imaginary parts in single
+/// precision, so that the compiler can vectorize the rotation over the
+/// partials. At the beginning of each block they are recomputed from the
+/// exact phase, which prevents the accumulation of rounding errors. The
+/// normalization by the sliding amplitude is applied once per block.
 /// \see AudioRecorderAdapter
 /// \see TuningIndicatorDrawer
 ///////////////////////////////////////////////////////////////////////////////
 
-class Stroboscope
+class Stroboscope : public SimpleThreadHandler
 {
 private:
-    typedef double PCMDataType;
-    typedef std::vector<PCMDataType> PacketType;
+    typedef FFTWType PCMDataType;
+    typedef FFTWVector PacketType;
+
+    /// Capacity of the ring buffer in samples (about 1.5 seconds)
+    static const std::size_t BUFFER_SIZE = 65536;
+
+    /// Maximal number of samples processed at once
+    static const int BLOCK_SIZE = 256;
+
+    /// Maximal waiting time of the worker for a wake-up by pushRawData
+    const int MAXIMAL_IDLE_TIME_IN_MILLISECONDS = 100;
 
     /// Damping factor of the normalizing amplitude level on a single frame (0...1)
     const double AMPLITUDE_DAMPING = 0.95;
@@ -79,23 +103,40 @@ public:
     using ComplexVector = std::vector<Complex>;     ///< Type for a vector of complex numbers
 
     Stroboscope (AudioRecorder*recorder);   ///< Constructor
-    void start () { mActive = true; }               ///< Start the stroboscope
-    void stop  () { mActive = false; }              ///< Stop the stroboscope
+    ~Stroboscope () { stop(); }                     ///< Destructor, stops the worker
+
+    virtual void start () override;
+    virtual void stop  () override;
 
     void setFramesPerSecond (double fps);
     void setFrequencies (const std::vector<double> &frequencies);
     void pushRawData (const PacketType &data);
 
 private:
+    void workerFunction() override final;
+    void processBlock (const float *pcm, int n);
+    void publishFrame ();
+
     AudioRecorder*mRecorder;                ///< Pointer to the audio recorder
-    bool mActive;                           ///< Flag indicating activity (start/stop)
-    int mSamplesPerFrame;                   ///< Number of PCM samples per frame
-    int mSampleCounter;                     ///< Actual number of PCM samples read
+    std::atomic<bool> mActive;              ///< Flag indicating activity (start/stop)
+    std::atomic<int> mSamplesPerFrame;      ///< Number of PCM samples per frame
+    int mSampleCounter;                     ///< Remaining number of PCM samples in the frame
     double mMaxAmplitude;                   ///< Sliding amplitude to normalize the data
-    ComplexVector mComplexPhase;            ///< Rotating complex number
-    ComplexVector mComplexIncrement;        ///< Factor by which the complex number rotates
+    LockFreeRingBuffer<PCMDataType> mBuffer;///< PCM data waiting for the worker
+    std::vector<PCMDataType> mPacket;       ///< Data read from the ring buffer
+    std::vector<float> mBlock;              ///< Block of PCM data in single precision
+    std::vector<double> mPhase;             ///< Exact phase of the rotating complex numbers
+    std::vector<double> mPhaseIncrement;    ///< Phase increment per sample
+    std::vector<float> mRotationRe;         ///< Real part of the rotation per sample
+    std::vector<float> mRotationIm;         ///< Imaginary part of the rotation per sample
+    std::vector<float> mPhasorRe;           ///< Real part of the rotating complex number
+    std::vector<float> mPhasorIm;           ///< Imaginary part of the rotating complex number
+    std::vector<float> mSumRe;              ///< Real part of the sum over the block
+    std::vector<float> mSumIm;              ///< Imaginary part of the sum over the block
     ComplexVector mMeanComplexPhase;        ///< Phase average over the actual frame
-    std::mutex mMutex;                      ///< Mutex protecting access from different threads
+    std::mutex mMutex;                      ///< Mutex protecting the partials against setFrequencies
+    std::mutex mWakeUpMutex;                ///< Mutex of the wake-up condition
+    std::condition_variable mWakeUp;        ///< Signals new data or the stop of the worker
 };
 
 #endif // STROBOSCOPE_H
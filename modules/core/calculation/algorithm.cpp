@@ -91,6 +91,24 @@ void Algorithm::updateTuningCurve(int keynumber, double frequency)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Update the tuning curve for several keys at once
+///
+/// All changes are transmitted in a single message.
+/// \param frequencies : Map of key numbers and new frequencies
+///////////////////////////////////////////////////////////////////////////////
+
+void Algorithm::updateTuningCurve(const std::map<int, double> &frequencies)
+{
+    for (auto &change : frequencies)
+    {
+        EptAssert (change.first>=0 and change.first<mNumberOfKeys,"Range of keynumber");
+        mKeyboard[change.first].setComputedFrequency(change.second);
+    }
+    MessageHandler::send<MessageChangeTuningCurve>(frequencies);
+}
+
+
 //-----------------------------------------------------------------------------
 //                         Show calculation progress
 //-----------------------------------------------------------------------------
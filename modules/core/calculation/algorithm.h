@@ -53,6 +53,7 @@ protected:
     virtual void algorithmWorkerFunction() = 0;
 
     void updateTuningCurve(int keynumber, double frequency);
+    void updateTuningCurve(const std::map<int,double> &frequencies);
 
     bool terminateThread() { return cancelThread(); }
 
@@ -120,6 +120,39 @@
 #   define CONFIG_DIALOG_SIZE 1
 #endif
 
+// Precision of the recorded signal and its Fourier transform:
+//     0: double precision (fftw3)
+//     1: single precision (fftw3f), requires linking against fftw3f
+// The entropy and accumulator math always uses double precision.
+// Can be enabled from qmake by EPT_CONFIG+=single_precision_fft
+#ifndef CONFIG_SINGLE_PRECISION_FFT
+#   define CONFIG_SINGLE_PRECISION_FFT 0
+#endif
+
+// Zero-padding of the recorded signal before the FFT:
+//     0: transform the signal with its actual length
+//     1: pad to the next size of the form 2^a 3^b 5^c. This changes the
+//        length and the bin spacing of the spectra sent by the SignalAnalyzer.
+#ifndef CONFIG_FFT_ZERO_PADDING
+#   define CONFIG_FFT_ZERO_PADDING 0
+#endif
+
+// Multithreaded FFTs for large transforms (final FFT of a keystroke):
+//     0: all transforms are single-threaded
+//     1: use the threaded planner, requires linking against fftw3_threads
+// Can be enabled from qmake by EPT_CONFIG+=fftw_threads
+#ifndef CONFIG_FFTW_THREADS
+#   define CONFIG_FFTW_THREADS 0
+#endif
+
+// Analysis of the selected key in the tuning mode:
+//     0: correlate the log-binned full spectrum with the recorded one
+//     1: zoom into the narrow bands around the partials of the key
+//        (experimental, not yet checked against the full spectrum)
+#ifndef CONFIG_ZOOM_TUNING_ANALYSIS
+#   define CONFIG_ZOOM_TUNING_ANALYSIS 0
+#endif
+
 // export defines for dynamic dlls on windows
 #if defined(_WIN32) && defined(EPT_DYNAMIC_CORE)
 # ifdef EPT_BUILD_CORE
@@ -23,6 +23,8 @@
 
 #include "core.h"
 #include "calculation/calculationmanager.h"
+#include "adapters/filemanager.h"
+#include "math/fftimplementation.h"
 #include "messages/message.h"
 #include "messages/messagehandler.h"
 #include "messages/messagekeyselectionchanged.h"
@@ -132,6 +134,8 @@ void Core::init(CoreInitialisationAdapter *initAdapter)
     mPlayerInterface->start();
 
     initAdapter->updateProgress (44);   // Initialize the signal analyzer
+    FFT_Implementation::loadWisdom(FileManager::getSingleton().getCacheFilePath(
+                                       FFT_Implementation::WISDOM_FILE_NAME));
     mSignalAnalyzer.init();
 
     initAdapter->updateProgress (55);   // Initialize the sound generator
@@ -176,6 +180,8 @@ void Core::exit()
     mPlayerInterface->exit();
     mRecorderInterface->exit();
     CalculationManager::getSingleton().stop();
+    FFT_Implementation::saveWisdom(FileManager::getSingleton().getCacheFilePath(
+                                       FFT_Implementation::WISDOM_FILE_NAME));
 
     mInitialized = false;
 }
@@ -63,6 +63,7 @@ CORE_MESSAGE_SYSTEM_HEADERS = \
     messages/messagechangetuningcurve.h \
     messages/messagetuningdeviation.h \
     messages/messagekeydatachanged.h \
+    messages/messagekeydelta.h \
     messages/messagestroboscope.h \
 
 CORE_MESSAGE_SYSTEM_SOURCES = \
@@ -81,6 +82,7 @@ CORE_MESSAGE_SYSTEM_SOURCES = \
     messages/messagechangetuningcurve.cpp \
     messages/messagetuningdeviation.cpp \
     messages/messagekeydatachanged.cpp \
+    messages/messagekeydelta.cpp \
     messages/messagestroboscope.cpp \
 
 #------------- Drawers --------------------
@@ -132,6 +134,7 @@ CORE_ADAPTER_SOURCES = \
 CORE_AUDIO_HEADERS = \
     audio/audiointerface.h \
     audio/circularbuffer.h \
+    audio/lockfreeringbuffer.h \
     audio/pcmdevice.h \
     audio/player/hammerknock.h \
     audio/player/soundgenerator.h \
@@ -159,10 +162,12 @@ CORE_AUDIO_SOURCES = \
 CORE_MATH_HEADERS = \
     math/fftadapter.h \
     math/fftimplementation.h \
+    math/logbinningplan.h \
     math/mathtools.h \
 
 CORE_MATH_SOURCES = \
     math/fftimplementation.cpp \
+    math/logbinningplan.cpp \
     math/mathtools.cpp \
 
 #--------------- System --------------------
@@ -170,6 +175,7 @@ CORE_MATH_SOURCES = \
 CORE_SYSTEM_HEADERS = \
     system/log.h \
     system/simplethreadhandler.h \
+    system/pipelinestage.h \
     system/eptexception.h \
     system/timer.h \
     system/version.h \
@@ -200,12 +206,16 @@ CORE_ANALYZER_HEADERS = \
     analyzers/fftanalyzer.h \
     analyzers/fftanalyzererrorcodes.h \
     analyzers/overpull.h \
+    analyzers/streamingspectrum.h \
+    analyzers/zoomanalyzer.h \
 
 CORE_ANALYZER_SOURCES = \
     analyzers/signalanalyzer.cpp \
     analyzers/keyrecognizer.cpp \
     analyzers/fftanalyzer.cpp \
     analyzers/overpull.cpp \
+    analyzers/streamingspectrum.cpp \
+    analyzers/zoomanalyzer.cpp \
 
 #---------------- Piano --------------------
 
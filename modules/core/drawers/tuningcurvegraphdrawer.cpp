@@ -111,12 +111,14 @@ void TuningCurveGraphDrawer::handleMessage(MessagePtr m)
         {
             // upate the marker positions upon key data change
             auto mkdc(std::static_pointer_cast<MessageKeyDataChanged>(m));
-            int index = mkdc->getIndex();
-            updateMarkerPosition(index, ROLE_COMPUTED_FREQUENCY);
-            updateMarkerPosition(index, ROLE_INHARMONICITY);
-            updateMarkerPosition(index, ROLE_RECORDED_FREQUENCY);
-            updateMarkerPosition(index, ROLE_TUNED_FREQUENCY);
-            updateMarkerPosition(index, ROLE_OVERPULL);
+            for (int index : mkdc->getIndices())
+            {
+                updateMarkerPosition(index, ROLE_COMPUTED_FREQUENCY);
+                updateMarkerPosition(index, ROLE_INHARMONICITY);
+                updateMarkerPosition(index, ROLE_RECORDED_FREQUENCY);
+                updateMarkerPosition(index, ROLE_TUNED_FREQUENCY);
+                updateMarkerPosition(index, ROLE_OVERPULL);
+            }
             break;
         }
         case Message::MSG_CLEAR_RECORDING:
@@ -24,20 +24,68 @@
 #ifndef FFTADAPTER
 #define FFTADAPTER
 
+#include <fftw3.h>
+
 #include "prerequisites.h"
 
+// Select the fftw3 interface matching FFTRealType
+#if CONFIG_SINGLE_PRECISION_FFT
+#   define EPT_FFTW(name) fftwf_##name
+#else
+#   define EPT_FFTW(name) fftw_##name
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Allocator for vectors which are aligned in the same way as fftw3
+/// allocates its own arrays.
+///
+/// Vectors using this allocator are allocated by fftw_malloc. Therefore,
+/// they can be passed directly to the FFT plans without copying, and the
+/// SIMD codelets of fftw3 as well as vectorized loops are always eligible.
+/// Apart from the alignment the allocator behaves like std::allocator.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+class FFTAllocator
+{
+public:
+    using value_type = T;           ///< Type of the allocated elements
+
+    FFTAllocator() noexcept {}
+    template <class U> FFTAllocator (const FFTAllocator<U> &) noexcept {}
+
+    /// \brief Allocate memory for n elements, throws std::bad_alloc on failure
+    T *allocate (std::size_t n)
+    {
+        if (n == 0) return nullptr;
+        void *p = EPT_FFTW(malloc)(n * sizeof(T));
+        if (not p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    /// \brief Release memory allocated by allocate
+    void deallocate (T *p, std::size_t) noexcept { if (p) EPT_FFTW(free)(p); }
+
+    template <class U> bool operator== (const FFTAllocator<U> &) const noexcept { return true; }
+    template <class U> bool operator!= (const FFTAllocator<U> &) const noexcept { return false; }
+};
+
 // Data types to be processed by the FFT software
+#if CONFIG_SINGLE_PRECISION_FFT
+using FFTRealType      = float;
+#else
 using FFTRealType      = double;
-using FFTComplexType   = std::complex<double>;
-using FFTRealVector    = std::vector<FFTRealType>;
-using FFTComplexVector = std::vector<FFTComplexType>;
+#endif
+using FFTComplexType   = std::complex<FFTRealType>;
+using FFTRealVector    = std::vector<FFTRealType, FFTAllocator<FFTRealType>>;
+using FFTComplexVector = std::vector<FFTComplexType, FFTAllocator<FFTComplexType>>;
 
 // external used datatypes
 
 /// data type
 using FFTWType      = FFTRealType;
 /// fftw array
-using FFTWVector = std::vector<FFTWType>;
+using FFTWVector = FFTRealVector;
 /// Type for a frequency-to-intensity map for graphics
 typedef std::map<double,double> FFTPolygon;
 
@@ -68,6 +116,8 @@ struct EPT_EXTERN FFTData {
     /// \brief Function to get the time of the signal in seconds
     /// \return 2 * fft.size() / samplingRate
     ///
+    /// If the signal was zero-padded before the transformation (see
+    /// CONFIG_FFT_ZERO_PADDING), this is the duration of the padded signal.
     ///////////////////////////////////////////////////////////////////////////////
     double getTime() {
         return fft.size() * 2.0 / samplingRate;
@@ -105,6 +155,9 @@ public:
     virtual void calculateFFT  (const FFTRealVector &in, FFTComplexVector &out) = 0;
     virtual void calculateFFT  (const FFTComplexVector &in, FFTRealVector &out) = 0;
 
+    // Forward FFT followed by the squared magnitudes (power spectrum)
+    virtual void calculatePowerspectrum (const FFTRealVector &in, FFTRealVector &powerspectrum) = 0;
+
     // Call these functions to speed up FFT with the same size
     virtual void optimize (FFTRealVector &in) = 0;
     virtual void optimize (FFTComplexVector &in) = 0;
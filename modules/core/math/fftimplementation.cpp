@@ -23,6 +23,7 @@
 
 #include "fftimplementation.h"
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <typeinfo>
@@ -31,10 +32,27 @@
 #include "../system/log.h"
 
 //-----------------------------------------------------------------------------
-//                              static mutex
+//                     static mutex and plan cache
 //-----------------------------------------------------------------------------
 
 std::mutex FFT_Implementation::mPlanMutex;
+FFT_Implementation::PlanCache FFT_Implementation::mPlanCacheRC;
+FFT_Implementation::PlanCache FFT_Implementation::mPlanCacheCR;
+uint64_t FFT_Implementation::mPlanRequests = 0;
+
+#if CONFIG_SINGLE_PRECISION_FFT
+const std::string FFT_Implementation::WISDOM_FILE_NAME = "fftw3f.wisdom";
+#else
+const std::string FFT_Implementation::WISDOM_FILE_NAME = "fftw3.wisdom";
+#endif
+
+const size_t FFT_Implementation::MAXIMAL_CACHED_PLANS = 16;
+const size_t FFT_Implementation::DEFAULT_THREADING_THRESHOLD = 1 << 18;
+
+std::atomic<int> FFT_Implementation::mNumberOfThreads(
+        std::max<int>(1, static_cast<int>(std::thread::hardware_concurrency())));
+std::atomic<size_t> FFT_Implementation::mThreadingThreshold(DEFAULT_THREADING_THRESHOLD);
+bool FFT_Implementation::mThreadsInitialized = false;
 
 
 //-----------------------------------------------------------------------------
@@ -52,14 +70,19 @@ FFT_Implementation::FFT_Implementation() :
     mCvec2(nullptr),
     mNRC(0),
     mNCR(0),
-    mPlanRC(nullptr),
-    mPlanCR(nullptr)
+    mPlanRC(),
+    mPlanCR()
 {
     // Check the consistency of types defined in the adapater:
+#if CONFIG_SINGLE_PRECISION_FFT
+    EptAssert (typeid(FFTRealType)==typeid(float),
+               "Single precision FFT only implemented for real data type float.");
+#else
     EptAssert (typeid(FFTRealType)==typeid(double),
                "FFT only implemented for real data type double.");
-    EptAssert (typeid(FFTComplexType)==typeid(std::complex<double>),
-               "FFT only implemented for complex data type std::complex<double>.");
+#endif
+    EptAssert (sizeof(FFTComplexType)==sizeof(EPT_FFTW(complex)),
+               "Complex data type has to match the fftw3 complex type.");
 }
 
 
@@ -68,20 +91,43 @@ FFT_Implementation::FFT_Implementation() :
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Destructor, deletes plans and local vector copies if existing.
+/// \brief Destructor, deletes local vector copies if existing.
+///
+/// The plans are shared with the cache. They are destroyed automatically
+/// when they are no longer used.
 ///////////////////////////////////////////////////////////////////////////////
 
 FFT_Implementation::~FFT_Implementation()
+{
+    try
+    {
+        if (mRvec1) EPT_FFTW(free)(mRvec1);
+        if (mCvec2) EPT_FFTW(free)(mCvec2);
+        if (mCvec1) EPT_FFTW(free)(mCvec1);
+        if (mRvec2) EPT_FFTW(free)(mRvec2);
+    }
+    catch (...) LogE("fftw3_free throwed an exception");
+}
+
+
+//-----------------------------------------------------------------------------
+//                       Destructor of a cached plan
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Destroys the fftw3 plan.
+///
+/// Since destroying a plan is not thread-safe, the destructor locks the
+/// plan mutex. Therefore, a plan must never be released while the mutex
+/// is already locked.
+///////////////////////////////////////////////////////////////////////////////
+
+FFT_Implementation::Plan::~Plan()
 {
     std::lock_guard<std::mutex> lock(mPlanMutex);
     try
     {
-        if (mPlanRC) fftw_destroy_plan(mPlanRC);
-        if (mPlanCR) fftw_destroy_plan(mPlanCR);
-        if (mRvec1) free(mRvec1);
-        if (mCvec2) fftw_free(mCvec2);
-        if (mCvec1) fftw_free(mCvec1);
-        if (mRvec2) free(mRvec2);
+        if (plan) EPT_FFTW(destroy_plan)(plan);
     }
     catch (...) LogE("fftw3_destroy_plan throwed an exception");
 }
@@ -96,15 +142,16 @@ FFT_Implementation::~FFT_Implementation()
 ///
 /// This function should be called at the beginning if the subsequent
 /// code performs many FFTs on vectors with varying content, but with
-/// the same location and the same size. Note that this function may be
-/// time-consuming, but it accelerates subsequent computations significantly.
+/// the same size. Note that this function may be time-consuming unless
+/// the corresponding wisdom has been loaded, but it accelerates subsequent
+/// computations significantly.
 ///
 /// \param in : vector of real numbers to be transformed
 ///////////////////////////////////////////////////////////////////////////////
 
 void FFT_Implementation::optimize (FFTRealVector &in)
 {
-    updatePlan(in,FFTW_PATIENT);
+    if (in.size() > 0) updatePlanRC(in.size(),FFTW_PATIENT);
 }
 
 
@@ -117,15 +164,268 @@ void FFT_Implementation::optimize (FFTRealVector &in)
 ///
 /// This function should be called at the beginning if the subsequent
 /// code performs many FFTs on vectors with varying content, but with
-/// the same location and the same size. Note that this function may be
-/// time-consuming, but it accelerates subsequent computations significantly.
+/// the same size. Note that this function may be time-consuming unless
+/// the corresponding wisdom has been loaded, but it accelerates subsequent
+/// computations significantly.
 ///
 /// \param in : vector of complex numbers to be transformed
 ///////////////////////////////////////////////////////////////////////////////
 
 void FFT_Implementation::optimize (FFTComplexVector &in)
 {
-    updatePlan(in,FFTW_MEASURE);
+    if (in.size() > 1) updatePlanCR(2*in.size()-2,FFTW_MEASURE);
+}
+
+
+//-----------------------------------------------------------------------------
+//                        Load and save the wisdom
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Load the wisdom of FFTW3 from a file.
+///
+/// This function should be called once on startup before any plans are
+/// created. A missing file is not an error.
+/// \param filename : Absolute path of the wisdom file
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::loadWisdom (const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(mPlanMutex);
+    initThreads();
+    try
+    {
+        if (EPT_FFTW(import_wisdom_from_filename)(filename.c_str()))
+        {
+            LogI("FFTW wisdom loaded from %s", filename.c_str());
+        }
+        else
+        {
+            LogI("No FFTW wisdom available at %s", filename.c_str());
+        }
+    }
+    catch (...) LogE("fftw_import_wisdom_from_filename throwed an exception");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Save the wisdom of FFTW3 to a file.
+///
+/// This function should be called on exit.
+/// \param filename : Absolute path of the wisdom file
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::saveWisdom (const std::string &filename)
+{
+    std::lock_guard<std::mutex> lock(mPlanMutex);
+    try
+    {
+        if (not EPT_FFTW(export_wisdom_to_filename)(filename.c_str()))
+        {
+            LogW("FFTW wisdom could not be written to %s", filename.c_str());
+        }
+    }
+    catch (...) LogE("fftw_export_wisdom_to_filename throwed an exception");
+}
+
+
+//-----------------------------------------------------------------------------
+//                    Get the next size with small factors
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Get the smallest size >= n of the form 2^a 3^b 5^c.
+///
+/// FFTW3 is fastest for sizes with small prime factors while sizes with
+/// large prime factors may be slow in planning and execution. Zero-padding
+/// a signal to the size returned here avoids such pathological cases.
+/// The returned size is always even.
+/// \param n : Minimal size
+/// \return Fast size
+///////////////////////////////////////////////////////////////////////////////
+
+size_t FFT_Implementation::getFastSize (size_t n)
+{
+    if (n <= 2) return 2;
+    size_t best = 2;
+    while (best < n) best *= 2;
+    // loop over all products 2*3^b*5^c and fill up with powers of two
+    for (size_t p5 = 2; p5 < best; p5 *= 5)
+    {
+        for (size_t p35 = p5; p35 < best; p35 *= 3)
+        {
+            size_t candidate = p35;
+            while (candidate < n) candidate *= 2;
+            if (candidate < best) best = candidate;
+        }
+    }
+    return best;
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Settings for multithreaded transforms
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Set the number of threads used for large transforms.
+///
+/// By default the number of hardware threads is used. The setting
+/// applies to plans created afterwards and is ignored unless
+/// CONFIG_FFTW_THREADS is set.
+/// \param threads : Number of threads, 1 disables multithreading
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::setNumberOfThreads (int threads)
+{
+    mNumberOfThreads = std::max(1, threads);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Set the minimal size of multithreaded transforms.
+///
+/// For small transforms the overhead of the threads exceeds the gain,
+/// therefore only transforms of at least this size are multithreaded.
+/// \param n : Minimal size of the transform
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::setThreadingThreshold (size_t n)
+{
+    mThreadingThreshold = n;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Get the number of threads to be used for a transform of size n.
+/// \param n : Size of the transform
+/// \return Number of threads, 1 if the transform is single-threaded
+///////////////////////////////////////////////////////////////////////////////
+
+int FFT_Implementation::getNumberOfThreads (size_t n)
+{
+#if CONFIG_FFTW_THREADS
+    if (n >= mThreadingThreshold) return mNumberOfThreads;
+#else
+    (void)n;
+#endif
+    return 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Initialize the threading support of FFTW3 once.
+///
+/// FFTW3 requires this to happen before any other call of the library,
+/// therefore it is called when loading the wisdom as well as before
+/// planning. The plan mutex has to be locked by the caller.
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::initThreads()
+{
+#if CONFIG_FFTW_THREADS
+    if (mThreadsInitialized) return;
+    if (not EPT_FFTW(init_threads)())
+    {
+        LogW("FFTW threads could not be initialized, using a single thread");
+        mNumberOfThreads = 1;
+    }
+    mThreadsInitialized = true;
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Prepare the global state of the planner for the next plan.
+///
+/// Since the number of threads is a global setting of the planner, this
+/// function has to be called with the plan mutex locked.
+/// \param threads : Number of threads for the next plan
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::preparePlanner (int threads)
+{
+#if CONFIG_FFTW_THREADS
+    initThreads();
+    EPT_FFTW(plan_with_nthreads)(std::min<int>(threads, mNumberOfThreads));
+#else
+    (void)threads;
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Private functions for the plan cache
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Check whether an existing plan satisfies the requested rigor.
+///
+/// The planner flags are ordered as ESTIMATE < MEASURE < PATIENT < EXHAUSTIVE.
+/// \param available : Flags of the existing plan
+/// \param requested : Requested flags
+/// \return true if the existing plan can be used
+///////////////////////////////////////////////////////////////////////////////
+
+bool FFT_Implementation::isSufficient (unsigned available, unsigned requested)
+{
+    auto rigor = [] (unsigned flags)
+    {
+        if (flags & FFTW_ESTIMATE) return 0;
+        if (flags & FFTW_EXHAUSTIVE) return 3;
+        if (flags & FFTW_PATIENT) return 2;
+        return 1;
+    };
+    return rigor(available) >= rigor(requested);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Insert a plan into the cache, discarding the least recently used.
+///
+/// The mutex has to be locked by the caller. Replaced and evicted plans
+/// are moved to the vector discarded which must be released by the caller
+/// after unlocking the mutex.
+/// \param cache : The plan cache
+/// \param n : Size of the transform
+/// \param plan : The new plan
+/// \param discarded : Vector collecting the discarded plans
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::insertPlan (PlanCache &cache, size_t n, const PlanPtr &plan,
+                                     std::vector<PlanPtr> &discarded)
+{
+    PlanPtr &entry = cache[n];
+    if (entry) discarded.push_back(std::move(entry));
+    entry = plan;
+
+    // evict the least recently used plans, but never the new one
+    // (its counter is only set by the caller after insertion)
+    while (cache.size() > MAXIMAL_CACHED_PLANS)
+    {
+        auto oldest = std::min_element(cache.begin(), cache.end(),
+            [n] (const PlanCache::value_type &a, const PlanCache::value_type &b)
+            { return a.first != n and (b.first == n or a.second->lastUse < b.second->lastUse); });
+        discarded.push_back(std::move(oldest->second));
+        cache.erase(oldest);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Check whether data can be passed directly to a cached plan.
+///
+/// The new-array execute functions of FFTW3 require that the arrays have
+/// the same SIMD alignment as the arrays used for planning. Since the
+/// plans are created on arrays allocated by fftw_malloc, the data has to
+/// be aligned in the same way.
+/// \param data : Pointer to the data
+/// \return true if the data is aligned
+///////////////////////////////////////////////////////////////////////////////
+
+bool FFT_Implementation::isAligned (const void *data)
+{
+    return EPT_FFTW(alignment_of)(static_cast<FFTRealType *>(const_cast<void *>(data))) == 0;
 }
 
 
@@ -134,39 +434,59 @@ void FFT_Implementation::optimize (FFTComplexVector &in)
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Construct a new plan for the FFT transformation if necessary.
+/// \brief Provide a plan for the FFT transformation if necessary.
 ///
-/// This function checks whether the plan and the local vectors still
-/// exist and whether they have the correct size. If so, the function does
-/// nothing which means that the existing plan will be reused. Ohterwise,
-/// it deletes the plan and the vectors and constructs them again
-/// with the given size.
+/// This function checks whether the local vectors exist and have the
+/// correct size and whether the current plan is sufficient. If so, the
+/// function does nothing. Otherwise the vectors are reallocated and the
+/// plan is taken from the shared cache. If the cache does not contain a
+/// suitable plan, a new one is created and cached.
 ///
-/// \param in : vector of real numbers of size N
+/// \param n : Size N of the real vector
 /// \param flags : fftw3 internal flags controlling planmaking
 ///////////////////////////////////////////////////////////////////////////////
 
-void FFT_Implementation::updatePlan (const FFTRealVector &in,
-                                     unsigned flags)
+void FFT_Implementation::updatePlanRC (size_t n, unsigned flags)
 {
     // if plan still exists and input vector has the same size do nothing
-    if (mPlanRC and mRvec1 and mCvec2 and in.size()==mNRC) return
-    EptAssert(in.size()>0,"vector size has to be nonzero");
+    const int threads = getNumberOfThreads(n);
+    if (mPlanRC and mPlanRC->threads == threads and mRvec1 and mCvec2 and n==mNRC and
+            isSufficient(mPlanRC->flags, flags)) return;
+    EptAssert(n>0,"vector size has to be nonzero");
 
+    std::vector<PlanPtr> discarded;     // released after unlocking
     std::lock_guard<std::mutex> lock(mPlanMutex);
     try {
-        // delete old plan and vectors
-        if (mPlanRC) fftw_destroy_plan(mPlanRC);
-        if (mRvec1) free(mRvec1);
-        if (mCvec2) fftw_free(mCvec2);
-
-        // allocate new vectors and create a new plan
-        mNRC   = in.size();
-        mRvec1 = static_cast<double *>(malloc(mNRC*sizeof(double)));
-        mCvec2 = static_cast<fftw_complex*>(fftw_malloc((mNRC/2+1)*sizeof(fftw_complex)));
-        EptAssert(mRvec1, "May not be nullptr");
-        EptAssert(mCvec2, "May not be nullptr");
-        mPlanRC = fftw_plan_dft_r2c_1d (static_cast<int>(mNRC), mRvec1, mCvec2, flags);
+        // reallocate vectors if the size has changed
+        if (n != mNRC or not mRvec1 or not mCvec2)
+        {
+            if (mRvec1) EPT_FFTW(free)(mRvec1);
+            if (mCvec2) EPT_FFTW(free)(mCvec2);
+            mNRC   = n;
+            mRvec1 = static_cast<FFTRealType *>(EPT_FFTW(malloc)(mNRC*sizeof(FFTRealType)));
+            mCvec2 = static_cast<EPT_FFTW(complex)*>(EPT_FFTW(malloc)((mNRC/2+1)*sizeof(EPT_FFTW(complex))));
+            EptAssert(mRvec1, "May not be nullptr");
+            EptAssert(mCvec2, "May not be nullptr");
+        }
+
+        // look for a cached plan, otherwise create a new one
+        PlanPtr plan;
+        auto cached = mPlanCacheRC.find(mNRC);
+        if (cached != mPlanCacheRC.end() and cached->second->threads == threads and
+                isSufficient(cached->second->flags, flags))
+            plan = cached->second;
+        else
+        {
+            plan = std::make_shared<Plan>();
+            plan->flags = flags;
+            plan->threads = threads;
+            preparePlanner(threads);
+            plan->plan = EPT_FFTW(plan_dft_r2c_1d) (static_cast<int>(mNRC), mRvec1, mCvec2, flags);
+            insertPlan(mPlanCacheRC, mNRC, plan, discarded);
+        }
+        plan->lastUse = ++mPlanRequests;
+        if (mPlanRC) discarded.push_back(std::move(mPlanRC));
+        mPlanRC = plan;
     }
     catch (...) LogE("fftw_pplan_dft_r2c_1d throwed an exception");
 }
@@ -177,44 +497,126 @@ void FFT_Implementation::updatePlan (const FFTRealVector &in,
 //-----------------------------------------------------------------------------
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief Construct a new plan for the FFT transformation if necessary.
+/// \brief Provide a plan for the FFT transformation if necessary.
 ///
-/// This function checks whether the plan and the local vectors still
-/// exist and whether they have the correct size. If so, the function does
-/// nothing which means that the existing plan will be reused. Ohterwise,
-/// it deletes the plan and the vectors and constructs them again
-/// with the given size.
+/// This function checks whether the local vectors exist and have the
+/// correct size and whether the current plan is sufficient. If so, the
+/// function does nothing. Otherwise the vectors are reallocated and the
+/// plan is taken from the shared cache. If the cache does not contain a
+/// suitable plan, a new one is created and cached.
 ///
-/// \param in : vector of complex numbers
+/// \param n : Size N of the real output vector
 /// \param flags : fftw3 internal flags controlling planmaking
 ///////////////////////////////////////////////////////////////////////////////
 
-void FFT_Implementation::updatePlan (const FFTComplexVector &in,
-                                     unsigned flags)
+void FFT_Implementation::updatePlanCR (size_t n, unsigned flags)
 {
     // if plan still exists and input vector has the same size do nothing
-    if (mPlanCR and mCvec1 and mRvec2 and in.size()==mNCR/2+1) return;
-    EptAssert(in.size()>0,"vector size has to be nonzero");
+    const int threads = getNumberOfThreads(n);
+    if (mPlanCR and mPlanCR->threads == threads and mCvec1 and mRvec2 and n==mNCR and
+            isSufficient(mPlanCR->flags, flags)) return;
+    EptAssert(n>0,"vector size has to be nonzero");
 
+    std::vector<PlanPtr> discarded;     // released after unlocking
     std::lock_guard<std::mutex> lock(mPlanMutex);
     try {
-        // delete old plan and vectors
-        if (mPlanCR) fftw_destroy_plan(mPlanCR);
-        if (mCvec1) fftw_free(mCvec1);
-        if (mRvec2) free(mRvec2);
-
-        // allocate new vectors and create a new plan
-        mNCR   = 2*in.size()-2;
-        mCvec1 = static_cast<fftw_complex*>(fftw_malloc((mNCR/2+1)*sizeof(fftw_complex)));
-        mRvec2 = static_cast<double *>(malloc(mNCR*sizeof(double)));
-        EptAssert(mCvec1, "May not be nullptr");
-        EptAssert(mRvec2, "May not be nullptr");
-        mPlanCR = fftw_plan_dft_c2r_1d (static_cast<int>(mNCR), mCvec1, mRvec2, flags);
+        // reallocate vectors if the size has changed
+        if (n != mNCR or not mCvec1 or not mRvec2)
+        {
+            if (mCvec1) EPT_FFTW(free)(mCvec1);
+            if (mRvec2) EPT_FFTW(free)(mRvec2);
+            mNCR   = n;
+            mCvec1 = static_cast<EPT_FFTW(complex)*>(EPT_FFTW(malloc)((mNCR/2+1)*sizeof(EPT_FFTW(complex))));
+            mRvec2 = static_cast<FFTRealType *>(EPT_FFTW(malloc)(mNCR*sizeof(FFTRealType)));
+            EptAssert(mCvec1, "May not be nullptr");
+            EptAssert(mRvec2, "May not be nullptr");
+        }
+
+        // look for a cached plan, otherwise create a new one
+        PlanPtr plan;
+        auto cached = mPlanCacheCR.find(mNCR);
+        if (cached != mPlanCacheCR.end() and cached->second->threads == threads and
+                isSufficient(cached->second->flags, flags))
+            plan = cached->second;
+        else
+        {
+            plan = std::make_shared<Plan>();
+            plan->flags = flags;
+            plan->threads = threads;
+            preparePlanner(threads);
+            plan->plan = EPT_FFTW(plan_dft_c2r_1d) (static_cast<int>(mNCR), mCvec1, mRvec2, flags);
+            insertPlan(mPlanCacheCR, mNCR, plan, discarded);
+        }
+        plan->lastUse = ++mPlanRequests;
+        if (mPlanCR) discarded.push_back(std::move(mPlanCR));
+        mPlanCR = plan;
     }
     catch (...) LogE("fftw_pplan_dft_c2r_1d throwed an exception");
 }
 
 
+//-----------------------------------------------------------------------------
+//               Private functions: execute the current plans
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Execute the plan real -> complex on the given arrays.
+///
+/// The plan is executed directly on the given arrays if they are aligned.
+/// Otherwise the data is passed through the local vectors. The input is
+/// not modified since one-dimensional r2c transforms preserve their input.
+/// \param in : Pointer to mNRC real numbers
+/// \param out : Pointer to mNRC/2+1 complex numbers
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::executeRC (const FFTRealType *in, EPT_FFTW(complex) *out)
+{
+    EptAssert (mPlanRC and mPlanRC->plan, "Plan has to exist");
+    FFTRealType *input = const_cast<FFTRealType *>(in);
+    EPT_FFTW(complex) *output = out;
+    if (not isAligned(input))
+    {
+        std::memcpy(mRvec1, in, mNRC*sizeof(FFTRealType));
+        input = mRvec1;
+    }
+    if (not isAligned(output)) output = mCvec2;
+    try {
+        EPT_FFTW(execute_dft_r2c)(mPlanRC->plan, input, output);
+    }
+    catch (...) LogE("fftw_execute throwed an exception");
+    if (output != out) std::memcpy(out, mCvec2, (mNRC/2+1)*sizeof(EPT_FFTW(complex)));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Execute the plan complex -> real on the given arrays.
+///
+/// The plan is executed directly on the given arrays if they are aligned.
+/// Otherwise the data is passed through the local vectors. Note that
+/// c2r transforms overwrite their input.
+/// \param in : Pointer to mNCR/2+1 complex numbers, destroyed
+/// \param out : Pointer to mNCR real numbers
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::executeCR (EPT_FFTW(complex) *in, FFTRealType *out)
+{
+    EptAssert (mPlanCR and mPlanCR->plan, "Plan has to exist");
+    EPT_FFTW(complex) *input = in;
+    FFTRealType *output = out;
+    if (not isAligned(input))
+    {
+        std::memcpy(mCvec1, in, (mNCR/2+1)*sizeof(EPT_FFTW(complex)));
+        input = mCvec1;
+    }
+    if (not isAligned(output)) output = mRvec2;
+    try {
+        EPT_FFTW(execute_dft_c2r)(mPlanCR->plan, input, output);
+    }
+    catch (...) LogE("fftw_execute throwed an exception");
+    if (output != out) std::memcpy(out, mRvec2, mNCR*sizeof(FFTRealType));
+}
+
+
 //-----------------------------------------------------------------------------
 //                   Calculate forward FFT real -> complex
 //-----------------------------------------------------------------------------
@@ -238,15 +640,23 @@ void FFT_Implementation::calculateFFT  (const FFTRealVector &in, FFTComplexVecto
         return;
     }
 
-    // Perform the computation
-    updatePlan(in,FFTW_ESTIMATE);
-    EptAssert (in.size()==mNRC and out.size()==mNRC/2+1,"Vector consistency");
-    try {
-        std::memcpy(mRvec1,in.data(),mNRC*sizeof(double));
-        fftw_execute(mPlanRC);
-        std::memcpy(out.data(), static_cast<const void*>(mCvec2),(mNRC/2+1)*sizeof(fftw_complex));
-    }
-    catch (...) LogE("fftw_execute throwed an exception");
+    calculateFFT(in.data(), out.data(), in.size());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Foward FFT on caller-owned buffers.
+///
+/// No data is copied if the buffers are aligned by fftw_malloc.
+/// \param in : Pointer to n real numbers
+/// \param out : Pointer to a buffer for n/2+1 complex numbers
+/// \param n : Size of the transform
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::calculateFFT  (const FFTRealType *in, FFTComplexType *out, size_t n)
+{
+    updatePlanRC(n,FFTW_ESTIMATE);
+    executeRC(in, reinterpret_cast<EPT_FFTW(complex)*>(out));
 }
 
 
@@ -258,20 +668,68 @@ void FFT_Implementation::calculateFFT  (const FFTRealVector &in, FFTComplexVecto
 /// \brief Backward FFT, mapping a complex vector with size M to a
 /// complex one with size 2M-1.
 ///
+/// Since the c2r transform destroys its input, the data is copied
+/// into the local vector.
 /// \param in : vector of complex numbers of size M
 /// \param out : vector of real numbers, will be resized to size 2*M-1
 ///////////////////////////////////////////////////////////////////////////////
 
 void FFT_Implementation::calculateFFT  (const FFTComplexVector &in, FFTRealVector &out)
 {
-    EptAssert (in.size()>=1,"calling FFT with empty vector");
+    EptAssert (in.size()>1,"calling FFT with empty vector");
     if (out.size() != 2*in.size()-2) out.resize(2*in.size()-2);
-    updatePlan(in,FFTW_ESTIMATE);
-    EptAssert (in.size()==mNCR/2+1 and out.size()==mNCR,"Vector consistency");
-    try {
-        std::memcpy(mCvec1,in.data(),(mNCR/2+1)*sizeof(fftw_complex));
-        fftw_execute(mPlanCR);
-        std::memcpy(out.data(),mRvec2,mNCR*sizeof(double));
+    updatePlanCR(out.size(),FFTW_ESTIMATE);
+    std::memcpy(mCvec1,in.data(),(mNCR/2+1)*sizeof(EPT_FFTW(complex)));
+    executeCR(mCvec1, out.data());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Backward FFT on caller-owned buffers.
+///
+/// No data is copied if the buffers are aligned by fftw_malloc.
+/// Note that the input is overwritten.
+/// \param in : Pointer to n/2+1 complex numbers, destroyed
+/// \param out : Pointer to a buffer for n real numbers
+/// \param n : Size of the transform
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::calculateFFT  (FFTComplexType *in, FFTRealType *out, size_t n)
+{
+    updatePlanCR(n,FFTW_ESTIMATE);
+    executeCR(reinterpret_cast<EPT_FFTW(complex)*>(in), out);
+}
+
+
+//-----------------------------------------------------------------------------
+//                     Calculate the power spectrum
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Forward FFT followed by the computation of the power spectrum.
+///
+/// The complex Fourier transform of size N/2+1 is written directly into
+/// the memory of the output vector, interpreting pairs of real numbers
+/// as complex numbers. The squared magnitudes are then computed in place
+/// in a single pass. Since the k-th power is computed from the elements
+/// 2k and 2k+1, no value is overwritten before it is read. Finally the
+/// vector is shrinked to N/2+1 without reallocation.
+/// \param in : vector of real numbers of size N
+/// \param powerspectrum : vector of squared magnitudes, resized to N/2+1
+///////////////////////////////////////////////////////////////////////////////
+
+void FFT_Implementation::calculatePowerspectrum (const FFTRealVector &in, FFTRealVector &powerspectrum)
+{
+    EptAssert (&in != &powerspectrum, "Input and output have to be different");
+    if (in.size() == 0) {
+        LogD("Calling FFT with empty vector. Skipping computation");
+        powerspectrum.clear();
+        return;
     }
-    catch (...) LogE("fftw_execute throwed an exception");
+    const size_t M = in.size()/2+1;
+    powerspectrum.resize(2*M);
+    FFTRealType *p = powerspectrum.data();
+    calculateFFT(in.data(), reinterpret_cast<FFTComplexType*>(p), in.size());
+    for (size_t k = 0; k < M; ++k) p[k] = p[2*k]*p[2*k] + p[2*k+1]*p[2*k+1];
+    powerspectrum.resize(M);
 }
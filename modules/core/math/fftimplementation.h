@@ -40,25 +40,56 @@
 /// so-called 'plan' has to be computed which optimizes the
 /// FFT algorithm. Then in a second step the actual Fourier transform is
 /// carried out. A plan may be kept for several calculations as long
-/// as the location of the vectors and their sizes are not changed.
+/// as the sizes are not changed and the vectors have the same alignment.
 /// By keeping a plan the computation time is drastically reduced.
 ///
 /// As of now, the second step (the FFT) is thread-safe while the first one is not.
 /// This means that only one thread is allowed to create a plan at a given
 /// time. To this end this implementation class protects all accesses
-/// to planmaking by a static mutex. In addition, it keeps local input
-/// and output vectors with a constant location.
+/// to planmaking by a static mutex.
+///
+/// The plans are stored in a static cache shared by all instances, holding
+/// one plan per size and direction. Since the local vectors are allocated
+/// by fftw_malloc, a cached plan can be executed on the vectors of any
+/// instance (new-array execute functions of FFTW3). The cache is bounded,
+/// the least recently used plans are discarded. A plan of higher rigor
+/// (requested by optimize) replaces a cached plan of lower rigor.
+///
+/// The accumulated knowledge of FFTW3 (wisdom) can be stored in a file on
+/// exit and reloaded on startup, so that time-consuming planning with
+/// FFTW_PATIENT has to be carried out only once per machine.
+///
+/// FFTW3 is fastest for sizes whose prime factors are 2, 3, and 5.
+/// The function getFastSize yields the next such size which can be used
+/// to zero-pad signals of arbitrary length.
 ///
 /// The class provides two types of FFTs, namely, real to complex
 /// and comples to real. The second one is the inverse of the first one.
 ///
-/// Since memory allocation should be carried out with the inbuilt
-/// allocation function of FFTW3, the implementation copies the vectors
-/// into local member vectors by memcpy.
+/// The transforms are executed directly on the memory of the caller if
+/// it has the same SIMD alignment as the local vectors allocated by
+/// fftw_malloc. Since FFTRealVector and FFTComplexVector use the aligned
+/// FFTAllocator, this is always the case for these vectors. Only
+/// misaligned data is copied into the local vectors.
+/// The function calculatePowerspectrum fuses the forward transform
+/// with the computation of the squared magnitudes, writing the result
+/// in place into the vector of the power spectrum without temporaries.
+/// Time-critical code may also call the pointer-based versions of
+/// calculateFFT which operate on caller-owned buffers.
+///
+/// If CONFIG_FFTW_THREADS is set, transforms whose size reaches a given
+/// threshold are planned with the threaded planner of FFTW3, distributing
+/// the computation on several cores. This mainly concerns the final FFT
+/// of a recorded keystroke which may have several million points. The
+/// number of threads and the threshold can be set by static functions.
+///
+/// Depending on CONFIG_SINGLE_PRECISION_FFT the double precision (fftw_)
+/// or the single precision (fftwf_) interface of FFTW3 is used, matching
+/// the FFTRealType defined in the adapter.
 ///////////////////////////////////////////////////////////////////////////////
 
-#include <fftw3.h>
 #include <mutex>
+#include <map>
 
 #include "prerequisites.h"
 
@@ -72,30 +103,73 @@ public:
 
     void calculateFFT  (const FFTRealVector &in, FFTComplexVector &out);
     void calculateFFT  (const FFTComplexVector &in, FFTRealVector &out);
+    void calculatePowerspectrum (const FFTRealVector &in, FFTRealVector &powerspectrum);
+
+    void calculateFFT  (const FFTRealType *in, FFTComplexType *out, size_t n);
+    void calculateFFT  (FFTComplexType *in, FFTRealType *out, size_t n);
 
     void optimize (FFTRealVector &in);
     void optimize (FFTComplexVector &in);
 
+    static const std::string WISDOM_FILE_NAME;  ///< Default name of the wisdom file
+    static const size_t MAXIMAL_CACHED_PLANS;   ///< Maximal number of cached plans per direction
+    static const size_t DEFAULT_THREADING_THRESHOLD; ///< Default minimal size of threaded transforms
+
+    static void loadWisdom (const std::string &filename);
+    static void saveWisdom (const std::string &filename);
+    static size_t getFastSize (size_t n);
+
+    static void setNumberOfThreads (int threads);
+    static void setThreadingThreshold (size_t n);
 
 private:
+    /// Cached plan, destroyed when it is neither cached nor in use.
+    struct Plan
+    {
+        EPT_FFTW(plan) plan = nullptr;  ///< The fftw3 plan
+        unsigned flags = 0;             ///< Flags used for planmaking
+        int threads = 1;                ///< Number of threads used by the plan
+        uint64_t lastUse = 0;           ///< Counter value of the last request
+        ~Plan();
+    };
+    using PlanPtr = std::shared_ptr<Plan>;
+    using PlanCache = std::map<size_t, PlanPtr>;
+
 
     // R and C mean: real and complex
     // CR means: complex to real
     // RC means: real to complex
 
-    double       *mRvec1;               ///< Local copy of incoming real data
-    double       *mRvec2;               ///< Local copy of outgoing real data
-    fftw_complex *mCvec1;               ///< Local copy of incoming complex data
-    fftw_complex *mCvec2;               ///< Local copy of outgoing complex data
-    size_t       mNRC;                  ///< Size of the FFT real -> complex
-    size_t       mNCR;                  ///< Size of the FFT complex -> real
+    FFTRealType       *mRvec1;          ///< Local copy of incoming real data
+    FFTRealType       *mRvec2;          ///< Local copy of outgoing real data
+    EPT_FFTW(complex) *mCvec1;          ///< Local copy of incoming complex data
+    EPT_FFTW(complex) *mCvec2;          ///< Local copy of outgoing complex data
+    size_t            mNRC;             ///< Size of the FFT real -> complex
+    size_t            mNCR;             ///< Size of the FFT complex -> real
 
-    fftw_plan mPlanRC;                  ///< Plan for FFT real -> complex
-    fftw_plan mPlanCR;                  ///< Plan for FFT complex -> real
+    PlanPtr mPlanRC;                    ///< Plan for FFT real -> complex
+    PlanPtr mPlanCR;                    ///< Plan for FFT complex -> real
     static std::mutex mPlanMutex;       ///< Static mutex protecting planmaking
-
-    void updatePlan (const FFTRealVector &in, unsigned flags);
-    void updatePlan (const FFTComplexVector &in, unsigned flags);
+    static PlanCache mPlanCacheRC;      ///< Shared plans real -> complex
+    static PlanCache mPlanCacheCR;      ///< Shared plans complex -> real
+    static uint64_t mPlanRequests;      ///< Counter for least recently used plans
+    static std::atomic<int> mNumberOfThreads;       ///< Threads for large transforms
+    static std::atomic<size_t> mThreadingThreshold; ///< Minimal size of threaded transforms
+    static bool mThreadsInitialized;    ///< Flag indicating that fftw threads are initialized
+
+    void updatePlanRC (size_t n, unsigned flags);
+    void updatePlanCR (size_t n, unsigned flags);
+    void executeRC (const FFTRealType *in, EPT_FFTW(complex) *out);
+    void executeCR (EPT_FFTW(complex) *in, FFTRealType *out);
+
+    static bool isAligned (const void *data);
+
+    static int getNumberOfThreads (size_t n);
+    static void initThreads();
+    static void preparePlanner (int threads);
+    static bool isSufficient (unsigned available, unsigned requested);
+    static void insertPlan (PlanCache &cache, size_t n, const PlanPtr &plan,
+                            std::vector<PlanPtr> &discarded);
 };
 
 #endif // FFT_IMPLEMENTATION_H
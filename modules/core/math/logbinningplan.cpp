@@ -0,0 +1,145 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//            Precomputed plan for logarithmic binning of spectra
+//=============================================================================
+
+#include "logbinningplan.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "../system/eptexception.h"
+#include "mathtools.h"
+
+//-----------------------------------------------------------------------------
+//                              Constructor
+//-----------------------------------------------------------------------------
+
+LogBinningPlan::LogBinningPlan() :
+    mInputSize(0),
+    mSamplingRate(0),
+    mOutputSize(0),
+    mEdges(),
+    mWeights(),
+    mFactors()
+{}
+
+
+//-----------------------------------------------------------------------------
+//                  Check whether the plan can be reused
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Check whether the plan was created for the given geometry.
+/// \param inputSize : Size of the linear spectrum
+/// \param samplingRate : Sampling rate of the linear spectrum
+/// \param outputSize : Number of logarithmic bins
+/// \return true if the plan can be applied without recomputation
+///////////////////////////////////////////////////////////////////////////////
+
+bool LogBinningPlan::isValid (size_t inputSize, int samplingRate, size_t outputSize) const
+{
+    return mEdges.size() > 0 and inputSize == mInputSize and
+            samplingRate == mSamplingRate and outputSize == mOutputSize;
+}
+
+
+//-----------------------------------------------------------------------------
+//                            Create the plan
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Create the plan for a given geometry.
+///
+/// The bin y of the target spectrum collects the input from f(y-1/2) to
+/// f(y+1/2). The input element at the edge between two bins is split
+/// according to the position of the edge. The edges are clipped to the
+/// range of the input in the same way as in MathTools::coarseGrainSpectrum,
+/// hence the plan reproduces its results.
+/// \param inputSize : Size of the linear spectrum
+/// \param samplingRate : Sampling rate of the linear spectrum
+/// \param outputSize : Number of logarithmic bins
+/// \param f : Function mapping the (continuous) bin index to the input index
+/// \param exponent : exponent used for the mapping
+///////////////////////////////////////////////////////////////////////////////
+
+void LogBinningPlan::create (size_t inputSize, int samplingRate, size_t outputSize,
+                             const std::function<double(double)> &f, double exponent)
+{
+    EptAssert(inputSize > 0 and outputSize > 0, "Sizes have to be positive");
+    mInputSize = inputSize;
+    mSamplingRate = samplingRate;
+    mOutputSize = outputSize;
+    mEdges.resize(outputSize + 1);
+    mWeights.resize(outputSize + 1);
+    mFactors.resize(outputSize);
+
+    const int last = static_cast<int>(inputSize) - 1;
+    std::vector<double> xs(outputSize + 1);
+    for (size_t y = 0; y <= outputSize; ++y)
+    {
+        xs[y] = f(y - 0.5);
+        const int x = MathTools::roundToInteger(xs[y]);
+        mEdges[y] = (y == 0 ? std::max(0, x) : std::min(x, last));
+        mWeights[y] = mEdges[y] - xs[y] + 0.5;
+    }
+    for (size_t y = 0; y < outputSize; ++y)
+        mFactors[y] = pow(xs[y] * xs[y+1], exponent);
+}
+
+
+//-----------------------------------------------------------------------------
+//                            Apply the plan
+//-----------------------------------------------------------------------------
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Map the linear spectrum X to the logarithmic spectrum Y.
+///
+/// The loop over the input elements within a bin is contiguous and
+/// free of branches, the edges are read from the plan.
+/// \param X : Linear spectrum with the size of the plan
+/// \param Y : Logarithmic spectrum, resized to the number of bins
+///////////////////////////////////////////////////////////////////////////////
+
+template <class VY>
+void LogBinningPlan::applyPlan (const FFTRealVector &X, VY &Y) const
+{
+    EptAssert(X.size() == mInputSize, "Plan does not match the input size");
+    Y.resize(mOutputSize);
+    const FFTRealType *x = X.data();
+    const int *edge = mEdges.data();
+    const double *weight = mWeights.data();
+    double leftarea = weight[0] * x[edge[0]];
+    for (size_t y = 0; y < mOutputSize; ++y)
+    {
+        double sum = 0;
+        for (int i = edge[y] + 1; i <= edge[y+1]; ++i) sum += x[i];
+        const double rightarea = weight[y+1] * x[edge[y+1]];
+        Y[y] = static_cast<typename VY::value_type>((sum + leftarea - rightarea) * mFactors[y]);
+        leftarea = rightarea;
+    }
+}
+
+void LogBinningPlan::apply (const FFTRealVector &X, std::vector<double> &Y) const
+{ applyPlan(X, Y); }
+
+void LogBinningPlan::apply (const FFTRealVector &X, FFTRealVector &Y) const
+{ applyPlan(X, Y); }
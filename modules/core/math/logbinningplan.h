@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//            Precomputed plan for logarithmic binning of spectra
+//=============================================================================
+
+#ifndef LOGBINNINGPLAN_H
+#define LOGBINNINGPLAN_H
+
+#include <vector>
+#include <functional>
+
+#include "prerequisites.h"
+#include "fftadapter.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Precomputed plan for mapping a linear spectrum to logarithmic bins
+///
+/// The power spectrum delivered by the FFT is linear in the frequency while
+/// the analyzers work with spectra that are logarithmic in the frequency.
+/// The coarse-graining map distributes the intensities of the FFT
+/// evenly into the target bins (see MathTools::coarseGrainSpectrum).
+///
+/// The bin edges depend only on the size of the FFT, the sampling rate, and
+/// the geometry of the target spectrum. Therefore, the plan computes the
+/// integer edges, the fractional weights of the edges, and the exponent
+/// factors once. Applying the plan is then a single pass over the FFT
+/// without calls of std::function and without evaluating pow. Since the
+/// size of the FFT is constant in the tuning mode, the plan is reused for
+/// every rolling FFT.
+///
+/// The mapping function has to be fixed for a given owner of the plan,
+/// the plan is identified by the input size, the sampling rate, and the
+/// output size only.
+///////////////////////////////////////////////////////////////////////////////
+
+class EPT_EXTERN LogBinningPlan
+{
+public:
+    LogBinningPlan();
+    ~LogBinningPlan() {}
+
+    bool isValid (size_t inputSize, int samplingRate, size_t outputSize) const;
+    void create (size_t inputSize, int samplingRate, size_t outputSize,
+                 const std::function<double(double)> &f, double exponent=0);
+
+    void apply (const FFTRealVector &X, std::vector<double> &Y) const;
+    void apply (const FFTRealVector &X, FFTRealVector &Y) const;
+
+private:
+    size_t mInputSize;                  ///< Size of the linear spectrum
+    int mSamplingRate;                  ///< Sampling rate of the linear spectrum
+    size_t mOutputSize;                 ///< Number of logarithmic bins
+    std::vector<int> mEdges;            ///< Index of the input at the left edge of each bin
+    std::vector<double> mWeights;       ///< Fraction of the edge element belonging to the right bin
+    std::vector<double> mFactors;       ///< Exponent factor of each bin
+
+    template <class VY>
+    void applyPlan (const FFTRealVector &X, VY &Y) const;
+};
+
+#endif // LOGBINNINGPLAN_H
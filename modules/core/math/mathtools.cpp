@@ -116,6 +116,11 @@ double MathTools::computeNorm (std::vector<double> &vec)
     return std::accumulate(vec.begin(), vec.end(), 0.0);
 }
 
+double MathTools::computeNorm (FFTRealVector &vec)
+{
+    return std::accumulate(vec.begin(), vec.end(), 0.0);
+}
+
 
 //-----------------------------------------------------------------------------
 //	                        Normalize a distribution
@@ -146,6 +151,8 @@ void MathTools::normalize (std::vector<double> &vec)
 /// \param Y : Target vector of a given size.
 /// \param f : Function used for coarse-graining
 /// \param exponent : exponent used for the mapping
+///
+/// For repeated mapping of FFT power spectra see LogBinningPlan.
 ///////////////////////////////////////////////////////////////////////////////
 
 
@@ -193,6 +200,11 @@ int MathTools::findMaximum (const std::vector<double> &X)
     return static_cast<int>(std::distance(X.begin(), std::max_element(X.begin(),X.end())));
 }
 
+int MathTools::findMaximum (const FFTRealVector &X)
+{
+    return static_cast<int>(std::distance(X.begin(), std::max_element(X.begin(),X.end())));
+}
+
 double MathTools::findSmoothedMaximum (const std::vector<double> &x)
 {
     auto maxElem = std::max_element(std::next(x.begin()), std::prev(x.end()));
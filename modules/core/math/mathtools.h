@@ -32,6 +32,7 @@
 #include <limits>
 
 #include "prerequisites.h"
+#include "fftadapter.h"
 
 namespace MathTools {
 
@@ -51,6 +52,7 @@ EPT_EXTERN void normalize (std::vector<double> &vec);
 
 /// Compute the norm of a vector
 EPT_EXTERN double computeNorm (std::vector<double> &vec);
+EPT_EXTERN double computeNorm (FFTRealVector &vec);
 
 /// Map a distribution in the vector X[x] to another vector Y[y]
 /// by means of a (possibly nonlinear) function x=f(y).
@@ -59,6 +61,9 @@ EPT_EXTERN void coarseGrainSpectrum (const std::vector<double> &X,
                           std::function<double(double y)> f,
                           double exponent=0);
 
+/// Entropy contribution x*log(x) of a single non-negative value (zero for x=0)
+inline double xlogx (double x) { return x>0 ? x*log(x) : 0; }
+
 /// Compute the Shannon entropy of a normalized probability distribution
 EPT_EXTERN double computeEntropy (const std::vector<double> &v);
 
@@ -68,6 +73,7 @@ EPT_EXTERN double computeRenyiEntropy (const std::vector<double> &v, const doubl
 /// Find the component where the vector has its maximum
 EPT_EXTERN int findMaximum (const std::vector<double> &X, int i, int j);
 EPT_EXTERN int findMaximum (const std::vector<double> &X);
+EPT_EXTERN int findMaximum (const FFTRealVector &X);
 
 /// Use a parabola to fit the maximum.
 EPT_EXTERN double findSmoothedMaximum (const std::vector<double> &x);
@@ -79,14 +85,14 @@ EPT_EXTERN double weightedArithmetricMean(const std::vector<double> &Y, size_t s
 EPT_EXTERN double restrictToInterval (double x, double xmin, double xmax);
 
 /// Map a vector to a different one by a unary map
-template <typename T>
-void transformVector (const std::vector<T> &v, std::vector<T> &w,
+template <typename T, class A>
+void transformVector (const std::vector<T,A> &v, std::vector<T,A> &w,
                       std::function<T(T)> f)
 { w.resize(v.size()); for (size_t i=0; i<v.size(); i++) w[i]=f(v[i]); }
 
-template <typename T>
-std::vector<T> transformVector (const std::vector<T> &v, std::function<T(T)> f)
-{ std::vector<T> w(v.size()); for (size_t i=0; i<v.size(); i++) w[i]=f(v[i]); return w; }
+template <typename T, class A>
+std::vector<T,A> transformVector (const std::vector<T,A> &v, std::function<T(T)> f)
+{ std::vector<T,A> w(v.size()); for (size_t i=0; i<v.size(); i++) w[i]=f(v[i]); return w; }
 
 } // MathTools
 
@@ -58,6 +58,7 @@ public:
         MSG_CHANGE_TUNING_CURVE,                ///< Message that the tuning curve has been adapted
         MSG_FINAL_KEY_RECOGNIZED,               ///< sent by KeyRecognizer if final FFT is ready
         MSG_KEY_DATA_CHANGED,                   ///< data of a key changed
+        MSG_KEY_DELTA,                          ///< scalar data of a key changed in the tuning mode
         MSG_KEY_SELECTION_CHANGED,              ///< Message that a key has been selected
         MSG_MIDI_EVENT,                         ///< new event from MIDI keyboard received
         MSG_MODE_CHANGED,                       ///< Message that the operation mode has changed
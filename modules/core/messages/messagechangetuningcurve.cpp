@@ -21,8 +21,13 @@
 
 MessageChangeTuningCurve::MessageChangeTuningCurve (int keynumber, double frequency)
     : Message(MSG_CHANGE_TUNING_CURVE),
-      mKeynumber(keynumber),
-      mFrequency(frequency)
+      mFrequencies({{keynumber, frequency}})
+{
+}
+
+MessageChangeTuningCurve::MessageChangeTuningCurve (const Frequencies &frequencies)
+    : Message(MSG_CHANGE_TUNING_CURVE),
+      mFrequencies(frequencies)
 {
 }
 
@@ -24,6 +24,8 @@
 #ifndef MESSAGECHANGETUNINGCURVE_H
 #define MESSAGECHANGETUNINGCURVE_H
 
+#include <map>
+
 #include "message.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -32,20 +34,26 @@
 /// During the calculation and upon manual manipulation the tuned frequency
 /// may change. These changes are emitted as messages in order to inform the
 /// GUI to redraw the corresponding green markers.
+///
+/// If several keys change at the same time, for example when the
+/// calculation moves a whole section of the tuning curve, all changes
+/// are transmitted in a single message.
 ///////////////////////////////////////////////////////////////////////////////
 
 class MessageChangeTuningCurve : public Message
 {
+public:
+    using Frequencies = std::map<int,double>;   ///< Map of key numbers to new frequencies
+
 public:
     MessageChangeTuningCurve (int keynumber, double frequency);
+    MessageChangeTuningCurve (const Frequencies &frequencies);
     ~MessageChangeTuningCurve() {};
 
-    int getKeyNumber() { return mKeynumber; }
-    double getFrequency() { return mFrequency; }
+    const Frequencies &getFrequencies() const { return mFrequencies; }
 
 private:
-    const int mKeynumber;
-    const double mFrequency;
+    const Frequencies mFrequencies;             ///< Changed keys and their new frequencies
 };
 
 #endif // MESSAGECHANGETUNINGCURVE_H
@@ -21,12 +21,20 @@
 
 MessageKeyDataChanged::MessageKeyDataChanged(int index, const Key *key) :
     Message(MSG_KEY_DATA_CHANGED),
-    mIndex(index),
+    mIndices(1, index),
     mKey(key)
 {
 
 }
 
+MessageKeyDataChanged::MessageKeyDataChanged(const std::vector<int> &indices) :
+    Message(MSG_KEY_DATA_CHANGED),
+    mIndices(indices),
+    mKey(nullptr)
+{
+
+}
+
 MessageKeyDataChanged::~MessageKeyDataChanged()
 {
 
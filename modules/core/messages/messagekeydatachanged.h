@@ -24,25 +24,33 @@
 #ifndef MESSAGEKEYDATACHANGED_H
 #define MESSAGEKEYDATACHANGED_H
 
+#include <vector>
+
 #include "message.h"
 #include "../piano/key.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief Message sent whenever the data associated with a single key changes.
+///
+/// If the data of several keys changes at the same time, for example when
+/// a whole section of the tuning curve is moved, all of them are reported
+/// in a single message. In this case getKey() returns nullptr.
 ///////////////////////////////////////////////////////////////////////////////
 
 class MessageKeyDataChanged : public Message
 {
 public:
     MessageKeyDataChanged(int index, const Key *key);
+    MessageKeyDataChanged(const std::vector<int> &indices);
     ~MessageKeyDataChanged();
 
-    int getIndex() const {return mIndex;}
+    int getIndex() const {return mIndices.front();}
+    const std::vector<int> &getIndices() const {return mIndices;}
     const Key *getKey() const {return mKey;}
 
 private:
-    const int mIndex;
-    const Key *mKey;
+    const std::vector<int> mIndices;    ///< Numbers of the changed keys
+    const Key *mKey;                    ///< The changed key if it is a single one
 };
 
 #endif // MESSAGEKEYDATACHANGED_H
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//              Message carrying changed scalar data of a single key
+//=============================================================================
+
+#include "messagekeydelta.h"
+
+#include "../piano/key.h"
+
+MessageKeyDelta::MessageKeyDelta(int keyNumber) :
+    Message(MSG_KEY_DELTA),
+    mKeyNumber(keyNumber),
+    mFields(0),
+    mComputedFrequency(0),
+    mTunedFrequency(0),
+    mOverpull(0),
+    mRecognitionQuality(0)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Constructor of a message carrying the tuned frequency
+/// \param keyNumber : Number of the key
+/// \param tunedFrequency : New tuned frequency in Hz
+///////////////////////////////////////////////////////////////////////////////
+
+MessageKeyDelta::MessageKeyDelta(int keyNumber, double tunedFrequency) :
+    MessageKeyDelta(keyNumber)
+{
+    setTunedFrequency(tunedFrequency);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Constructor of a message carrying the overpull
+/// \param keyNumber : Number of the key
+/// \param tunedFrequency : New tuned frequency in Hz, not carried if zero
+/// \param overpull : New overpull in cents
+///////////////////////////////////////////////////////////////////////////////
+
+MessageKeyDelta::MessageKeyDelta(int keyNumber, double tunedFrequency, double overpull) :
+    MessageKeyDelta(keyNumber)
+{
+    if (tunedFrequency > 0) setTunedFrequency(tunedFrequency);
+    setOverpull(overpull);
+}
+
+MessageKeyDelta &MessageKeyDelta::setComputedFrequency (double f)
+{
+    mComputedFrequency = f;
+    mFields |= COMPUTED_FREQUENCY;
+    return *this;
+}
+
+MessageKeyDelta &MessageKeyDelta::setTunedFrequency (double f)
+{
+    mTunedFrequency = f;
+    mFields |= TUNED_FREQUENCY;
+    return *this;
+}
+
+MessageKeyDelta &MessageKeyDelta::setOverpull (double cents)
+{
+    mOverpull = cents;
+    mFields |= OVERPULL;
+    return *this;
+}
+
+MessageKeyDelta &MessageKeyDelta::setRecognitionQuality (double q)
+{
+    mRecognitionQuality = q;
+    mFields |= QUALITY;
+    return *this;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Write the fields carried by the message into a key
+/// \param key : The key to be modified, all other fields remain unchanged
+///////////////////////////////////////////////////////////////////////////////
+
+void MessageKeyDelta::applyTo (Key &key) const
+{
+    if (has(COMPUTED_FREQUENCY)) key.setComputedFrequency(mComputedFrequency);
+    if (has(TUNED_FREQUENCY)) key.setTunedFrequency(mTunedFrequency);
+    if (has(OVERPULL)) key.setOverpull(mOverpull);
+    if (has(QUALITY)) key.setRecognitionQuality(mRecognitionQuality);
+}
@@ -0,0 +1,86 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//              Message carrying changed scalar data of a single key
+//=============================================================================
+
+#ifndef MESSAGEKEYDELTA_H
+#define MESSAGEKEYDELTA_H
+
+#include "message.h"
+
+class Key;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Lightweight message carrying changed scalar data of a single key.
+///
+/// In the tuning mode the SignalAnalyzer updates the tuned frequency and
+/// the overpull of the keys several times per second. Sending a complete
+/// copy of the key (including its spectrum and peaks) for each update would
+/// be wasteful. Instead, this message carries only the key number and the
+/// fields that have changed. The PianoManager applies the changes in place
+/// and notifies the other components by a MessageKeyDataChanged.
+///
+/// Messages carrying a complete key (MessageFinalKey) are reserved for
+/// actual recordings.
+///////////////////////////////////////////////////////////////////////////////
+
+class EPT_EXTERN MessageKeyDelta : public Message
+{
+public:
+    /// Fields of the key which can be carried by the message
+    enum Field
+    {
+        COMPUTED_FREQUENCY = 1,     ///< Computed frequency
+        TUNED_FREQUENCY    = 2,     ///< Tuned frequency
+        OVERPULL           = 4,     ///< Overpull in cents
+        QUALITY            = 8,     ///< Recognition quality
+    };
+
+public:
+    MessageKeyDelta(int keyNumber);
+    MessageKeyDelta(int keyNumber, double tunedFrequency);
+    MessageKeyDelta(int keyNumber, double tunedFrequency, double overpull);
+    ~MessageKeyDelta() {}
+
+    MessageKeyDelta &setComputedFrequency (double f);
+    MessageKeyDelta &setTunedFrequency (double f);
+    MessageKeyDelta &setOverpull (double cents);
+    MessageKeyDelta &setRecognitionQuality (double q);
+
+    int getKeyNumber() const { return mKeyNumber; }
+    bool has (Field field) const { return (mFields & field) != 0; }
+    double getComputedFrequency() const { return mComputedFrequency; }
+    double getTunedFrequency() const { return mTunedFrequency; }
+    double getOverpull() const { return mOverpull; }
+    double getRecognitionQuality() const { return mRecognitionQuality; }
+
+    void applyTo (Key &key) const;  // Write the carried fields into a key
+
+private:
+    const int mKeyNumber;           ///< Number of the key
+    int mFields;                    ///< Bit mask of the carried fields
+    double mComputedFrequency;      ///< Computed frequency in Hz
+    double mTunedFrequency;         ///< Tuned frequency in Hz
+    double mOverpull;               ///< Overpull in cents
+    double mRecognitionQuality;     ///< Quality of recognition
+};
+
+#endif // MESSAGEKEYDELTA_H
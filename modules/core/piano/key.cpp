@@ -31,8 +31,8 @@
 
 // Constants characterizing the logarighmically bins, do not change!
 
-const int Key::NumberOfBins  = 10800;       // Number of log. bins
-const int Key::BinsPerOctave = 1200;        // bins per octave
+constexpr int Key::NumberOfBins;            // Number of log. bins (see header)
+constexpr int Key::BinsPerOctave;           // bins per octave (see header)
 const double Key::fmin       = 20.601722;   // frequ. of lowest bin
 
 
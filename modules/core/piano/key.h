@@ -50,8 +50,8 @@ class EPT_EXTERN Key
 public:
     // Charactereistics of the logarithmically binned spectrum
 
-    static const int NumberOfBins;                  ///< Total number of slots: 9 octaves
-    static const int BinsPerOctave;                 ///< Number of slots per ocatave (here 1 cent)
+    static constexpr int NumberOfBins = 10800;      ///< Total number of slots: 9 octaves
+    static constexpr int BinsPerOctave = 1200;      ///< Number of slots per ocatave (here 1 cent)
     static const double fmin;                       ///< Mimimal frequency of logbinned spectrum in Hz
 
     using SpectrumType = std::vector<double>;       ///< Type of a log-binned spectrum
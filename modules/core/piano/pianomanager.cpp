@@ -33,6 +33,7 @@
 #include "../messages/messagechangetuningcurve.h"
 #include "../messages/messageprojectfile.h"
 #include "../messages/messagekeydatachanged.h"
+#include "../messages/messagekeydelta.h"
 #include "../adapters/modeselectoradapter.h"
 #include "../piano/key.h"
 
@@ -151,16 +152,37 @@ void PianoManager::handleMessage(MessagePtr m)
         handleNewKey(keynumber,keyptr);
     }
     break;
-    case Message::MSG_CHANGE_TUNING_CURVE:
+    case Message::MSG_KEY_DELTA:
     {
-        auto message(std::static_pointer_cast<MessageChangeTuningCurve>(m));
+        // changes of single fields are only applied in the tuning mode,
+        // like the overpull and tuned frequency in handleNewKey
+        if (mOperationMode != MODE_TUNING) break;
+        auto message(std::static_pointer_cast<MessageKeyDelta>(m));
         int keynumber = message->getKeyNumber();
-        double frequency = message->getFrequency();
         EptAssert(keynumber >= 0 and keynumber < mPiano.getKeyboard().getNumberOfKeys(), "range of keynumber");
-        mPiano.getKey(keynumber).setComputedFrequency(frequency);
+        message->applyTo(mPiano.getKey(keynumber));
         MessageHandler::send<MessageKeyDataChanged>(keynumber, mPiano.getKeyPtr(keynumber));
     }
     break;
+    case Message::MSG_CHANGE_TUNING_CURVE:
+    {
+        auto message(std::static_pointer_cast<MessageChangeTuningCurve>(m));
+        std::vector<int> keynumbers;
+        for (auto &change : message->getFrequencies())
+        {
+            int keynumber = change.first;
+            double frequency = change.second;
+            EptAssert(keynumber >= 0 and keynumber < mPiano.getKeyboard().getNumberOfKeys(), "range of keynumber");
+            mPiano.getKey(keynumber).setComputedFrequency(frequency);
+            keynumbers.push_back(keynumber);
+        }
+        // notify the listeners by a single message
+        if (keynumbers.size() == 1)
+            MessageHandler::send<MessageKeyDataChanged>(keynumbers.front(), mPiano.getKeyPtr(keynumbers.front()));
+        else if (keynumbers.size() > 1)
+            MessageHandler::send<MessageKeyDataChanged>(keynumbers);
+    }
+    break;
     default:
     break;
     }
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * Copyright 2018 Haye Hinrichsen, Christoph Wick
+ *
+ * This file is part of Entropy Piano Tuner.
+ *
+ * Entropy Piano Tuner is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * Entropy Piano Tuner is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * Entropy Piano Tuner. If not, see http://www.gnu.org/licenses/.
+ *****************************************************************************/
+
+//=============================================================================
+//                    Pipeline stage with a latest-wins queue
+//=============================================================================
+
+#ifndef PIPELINESTAGE_H
+#define PIPELINESTAGE_H
+
+#include <deque>
+#include <algorithm>
+#include <string>
+#include <cstdint>
+
+#include "simplethreadhandler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Counters describing the traffic through a LatestWinsQueue
+///////////////////////////////////////////////////////////////////////////////
+
+struct QueueStatistics
+{
+    uint64_t pushed = 0;        ///< Number of items entering the queue
+    uint64_t processed = 0;     ///< Number of items taken by the consumer
+    uint64_t dropped = 0;       ///< Number of items replaced by newer ones
+    size_t depth = 0;           ///< Current number of waiting items
+    size_t maximalDepth = 0;    ///< Largest number of waiting items
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Bounded queue with a latest-wins policy
+///
+/// The producer never waits: If the queue is full when a new item arrives,
+/// the oldest waiting item is discarded and counted as dropped. Thus, under
+/// overload the consumer always works on the most recent data while the
+/// number of waiting items stays bounded.
+///
+/// The consumer blocks in pop() until an item is available or until
+/// interrupt() is called.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+class LatestWinsQueue
+{
+public:
+    LatestWinsQueue(size_t capacity) :
+        mCapacity(capacity),
+        mInterrupted(false)
+    {
+        EptAssert(capacity > 0, "The queue capacity has to be positive");
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Append an item, dropping the oldest one if the queue is full
+    /// \param item : The new item
+    ///////////////////////////////////////////////////////////////////////////
+    void push(T item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mItems.size() >= mCapacity)
+            {
+                mItems.pop_front();
+                ++mStatistics.dropped;
+            }
+            mItems.push_back(std::move(item));
+            ++mStatistics.pushed;
+            mStatistics.maximalDepth = std::max(mStatistics.maximalDepth, mItems.size());
+        }
+        mCondition.notify_one();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Wait for the next item
+    /// \param item : Reference where the item is stored
+    /// \return false if the queue was interrupted, true otherwise
+    ///////////////////////////////////////////////////////////////////////////
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] {return mInterrupted or not mItems.empty();});
+        if (mInterrupted) return false;
+        item = std::move(mItems.front());
+        mItems.pop_front();
+        ++mStatistics.processed;
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Wake up the consumer, pop() returns false until clear()
+    ///////////////////////////////////////////////////////////////////////////
+    void interrupt()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mInterrupted = true;
+        }
+        mCondition.notify_all();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Discard all waiting items and reset the interruption
+    ///////////////////////////////////////////////////////////////////////////
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mItems.clear();
+        mInterrupted = false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Get the current counters of the queue
+    ///////////////////////////////////////////////////////////////////////////
+    QueueStatistics getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        QueueStatistics statistics = mStatistics;
+        statistics.depth = mItems.size();
+        return statistics;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Reset all counters to zero
+    ///////////////////////////////////////////////////////////////////////////
+    void resetStatistics()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStatistics = QueueStatistics();
+    }
+
+private:
+    const size_t mCapacity;                 ///< Maximal number of waiting items
+    std::deque<T> mItems;                   ///< The waiting items, oldest first
+    bool mInterrupted;                      ///< Flag for waking up the consumer
+    QueueStatistics mStatistics;            ///< Traffic counters
+    mutable std::mutex mMutex;              ///< Mutex protecting all members
+    std::condition_variable mCondition;     ///< Signals new items and interruptions
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief Stage of a processing pipeline running on a persistent worker
+///
+/// A pipeline stage consumes the items of a LatestWinsQueue on its own
+/// persistent worker thread (see SimpleThreadHandler). The producer calls
+/// push(), which never blocks. The first item after a stop() starts the
+/// consumer loop again. Derived classes implement processItem().
+///
+/// Derived classes have to call stop() in their destructor. The destructor
+/// of the base class runs after the derived object has been destroyed, so
+/// that the worker must not be running any more at this point.
+///
+/// The counters of the queue can be used to monitor whether the stage
+/// keeps pace with its producer.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class T>
+class PipelineStage : public SimpleThreadHandler
+{
+public:
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Constructor
+    /// \param name : Name of the worker thread
+    /// \param capacity : Maximal number of waiting items
+    ///////////////////////////////////////////////////////////////////////////
+    PipelineStage(const std::string &name, size_t capacity) :
+        SimpleThreadHandler(true),
+        mName(name),
+        mQueue(capacity)
+    {}
+
+    virtual ~PipelineStage()
+    {
+        if (isThreadRunning()) LogE("Pipeline stage %s was not stopped by the derived class", mName.c_str());
+        stop();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Hand over an item to the stage
+    ///
+    /// The consumer loop is started under a mutex shared with stop(), so
+    /// that a concurrent stop() cannot leave the item without a consumer.
+    /// \param item : The item to be processed
+    ///////////////////////////////////////////////////////////////////////////
+    void push(T item)
+    {
+        mQueue.push(std::move(item));
+        std::lock_guard<std::mutex> lock(mStartMutex);
+        if (not isThreadRunning()) start();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Stop the consumer loop and discard the waiting items
+    ///////////////////////////////////////////////////////////////////////////
+    virtual void stop() override
+    {
+        std::lock_guard<std::mutex> lock(mStartMutex);
+        mQueue.interrupt();
+        SimpleThreadHandler::stop();
+        mQueue.clear();
+    }
+
+    /// \brief Get the counters of the input queue
+    QueueStatistics getStatistics() const { return mQueue.getStatistics(); }
+
+    /// \brief Reset the counters of the input queue
+    void resetStatistics() { mQueue.resetStatistics(); }
+
+protected:
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Process a single item, executed on the worker thread
+    /// \param item : The item taken from the queue
+    ///////////////////////////////////////////////////////////////////////////
+    virtual void processItem(T &item) = 0;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    /// \brief Consumer loop of the stage
+    ///////////////////////////////////////////////////////////////////////////
+    void workerFunction() override final
+    {
+        setThreadName(mName);
+        T item;
+        while (not cancelThread() and mQueue.pop(item))
+        {
+            processItem(item);
+            item = T();             // release the item while waiting
+        }
+    }
+
+    const std::string mName;                ///< Name of the worker thread
+    LatestWinsQueue<T> mQueue;              ///< Queue of waiting items
+    std::mutex mStartMutex;                 ///< Serializes starting and stopping the consumer
+};
+
+#endif // PIPELINESTAGE_H
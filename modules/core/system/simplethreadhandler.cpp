@@ -19,24 +19,80 @@
 
 #include "simplethreadhandler.h"
 
-SimpleThreadHandler::SimpleThreadHandler()
+SimpleThreadHandler::SimpleThreadHandler(bool persistentWorker)
     : mCancelThread(false),
-      mRunning(false) {
+      mRunning(false),
+      mPersistentWorker(persistentWorker),
+      mJobPending(false),
+      mJobActive(false),
+      mTerminate(false) {
 }
 
 SimpleThreadHandler::~SimpleThreadHandler() {
     stop();
+    if (mPersistentWorker) {
+        {
+            std::lock_guard<std::mutex> lock(mJobMutex);
+            mTerminate = true;
+        }
+        mJobCondition.notify_all();
+        if (mThread.joinable()) mThread.join();
+    }
 }
 
 void SimpleThreadHandler::start() {
-    stop();
+    if (not mPersistentWorker) {
+        stop();
+        setCancelThread(false);
+        mThread = std::thread(&SimpleThreadHandler::simpleWorkerFunction, this);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mJobMutex);
+    if (std::this_thread::get_id() != mThread.get_id()) {
+        // cancel the running job and wait until it is finished
+        setCancelThread(true);
+        mJobCondition.wait(lock, [this] {return not mJobActive;});
+    }
     setCancelThread(false);
-    mThread = std::thread(&SimpleThreadHandler::simpleWorkerFunction, this);
+    mRunning = true;
+    mJobPending = true;
+    if (not mThread.joinable()) {
+        mThread = std::thread(&SimpleThreadHandler::persistentWorkerLoop, this);
+    }
+    lock.unlock();
+    mJobCondition.notify_all();
 }
 
 void SimpleThreadHandler::stop() {
     setCancelThread(true);                  // Set cancel flag to true
-    if (mThread.joinable()) mThread.join(); // Wait for thread to terminate
+    if (not mPersistentWorker) {
+        if (mThread.joinable()) mThread.join(); // Wait for thread to terminate
+        return;
+    }
+
+    // Withdraw a pending job and wait for the running job to finish
+    std::unique_lock<std::mutex> lock(mJobMutex);
+    if (mJobPending) {
+        mJobPending = false;
+        mRunning = false;
+    }
+    if (std::this_thread::get_id() != mThread.get_id()) {
+        mJobCondition.wait(lock, [this] {return not mJobActive;});
+    }
+}
+
+void SimpleThreadHandler::waitForCompletion() {
+    if (not mPersistentWorker) {
+        if (mThread.joinable()) mThread.join();
+        return;
+    }
+
+    // Wait until the pending job has been taken and finished
+    std::unique_lock<std::mutex> lock(mJobMutex);
+    if (std::this_thread::get_id() != mThread.get_id()) {
+        mJobCondition.wait(lock, [this] {return not mJobPending and not mJobActive;});
+    }
 }
 
 void SimpleThreadHandler::simpleWorkerFunction() {
@@ -61,3 +117,21 @@ void SimpleThreadHandler::simpleWorkerFunction() {
 
     mRunning = false;
 }
+
+void SimpleThreadHandler::persistentWorkerLoop() {
+    std::unique_lock<std::mutex> lock(mJobMutex);
+    while (true) {
+        mJobCondition.wait(lock, [this] {return mJobPending or mTerminate;});
+        if (mTerminate) break;
+        mJobPending = false;
+        mJobActive = true;
+        lock.unlock();
+
+        simpleWorkerFunction();
+
+        lock.lock();
+        mJobActive = false;
+        if (mJobPending) mRunning = true;   // a new job was submitted meanwhile
+        mJobCondition.notify_all();
+    }
+}
@@ -28,6 +28,7 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 
 #include "../prerequisites.h"
 #include "../system/log.h"
@@ -52,6 +53,17 @@
 /// flag is set and the thread will terminate after some time depending
 /// on the implementation of the workerFunction(). For keeping the thread
 /// idle in the workerFunction() call the member function msleep().
+///
+/// <B>Persistent worker:</B> Classes which start short jobs at a high rate
+/// (e.g. the KeyRecognizer on every FFT) can pass true to the constructor.
+/// Then a single worker thread is created on the first call of start()
+/// and kept alive until destruction. Each call of start() submits the
+/// workerFunction() as a new job to this thread, cancelling the running
+/// job first. stop() cancels the running job and waits until the worker
+/// is idle, but does not terminate the thread.
+///
+/// The cancel flag is atomic, so that cancelThread() can be called in
+/// tight loops without locking.
 ///////////////////////////////////////////////////////////////////////////////
 
 class EPT_EXTERN SimpleThreadHandler
@@ -66,8 +78,10 @@ public:
     ///////////////////////////////////////////////////////////////////////////////
     /// The constructor sets the cancel-thread flag to false.
     /// It does not yet start the thread.
+    /// \param persistentWorker : Keep the thread alive and run each start()
+    /// as a job of this thread.
     ///////////////////////////////////////////////////////////////////////////////
-    SimpleThreadHandler();
+    SimpleThreadHandler(bool persistentWorker = false);
 
     ///////////////////////////////////////////////////////////////////////////////
     /// The destructor waits for the current thread to stop if it is running
@@ -77,17 +91,26 @@ public:
 
     ///////////////////////////////////////////////////////////////////////////////
     /// If the thread is already running register it for termination and wait
-    /// until it has terminated. Then restart a new thread.
+    /// until it has terminated. Then restart a new thread. For a persistent
+    /// worker the running job is cancelled and a new job is submitted.
     ///////////////////////////////////////////////////////////////////////////////
     virtual void start();
 
     ///////////////////////////////////////////////////////////////////////////////
     /// Mark the thread for cancellation. This function waits for termination of the
     /// thread, i.e. it blocks until the thread has been shut down. This waiting
-    /// time will depend on the implementation of the workerFunction.
+    /// time will depend on the implementation of the workerFunction. For a
+    /// persistent worker the function waits until the current job is finished.
     ///////////////////////////////////////////////////////////////////////////////
     virtual void stop();
 
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Wait until the thread has finished without cancelling it. For a
+    /// persistent worker the function waits until the submitted job has been
+    /// carried out completely.
+    ///////////////////////////////////////////////////////////////////////////////
+    void waitForCompletion();
+
     ///////////////////////////////////////////////////////////////////////////////
     /// With this function it is possible to rename the thread. This is particularly
     /// useful for debugging since the Qt-creator shows the thread name in a list.
@@ -138,7 +161,6 @@ protected:
     ///////////////////////////////////////////////////////////////////////////////
     void setCancelThread(bool b)
     {
-        std::lock_guard<std::mutex> lock(mLockMutex); // protect remainder of block
         mCancelThread = b;
     }
 
@@ -147,8 +169,7 @@ protected:
     ///////////////////////////////////////////////////////////////////////////////
     bool cancelThread() const
     {
-        std::lock_guard<std::mutex> lock(mLockMutex);  // protect remainder of block
-        return mCancelThread;
+        return mCancelThread.load(std::memory_order_relaxed);
     }
 
     ///////////////////////////////////////////////////////////////////////////////
@@ -177,11 +198,22 @@ private:
     ///////////////////////////////////////////////////////////////////////////////
     void simpleWorkerFunction();
 
+    ///////////////////////////////////////////////////////////////////////////////
+    /// Loop of the persistent worker thread, waiting for submitted jobs.
+    ///////////////////////////////////////////////////////////////////////////////
+    void persistentWorkerLoop();
+
 private:
-    bool mCancelThread;                     ///< Cancel flag
-    std::atomic<bool> mRunning;             ///< Is the thread running
+    std::atomic<bool> mCancelThread;        ///< Cancel flag
+    std::atomic<bool> mRunning;             ///< Is the thread (the job) running
     std::thread mThread;                    ///< Local thread member variable
-    mutable std::mutex mLockMutex;          ///< Mutex protecting the cancel flag
+
+    const bool mPersistentWorker;           ///< Keep the thread and run jobs
+    std::mutex mJobMutex;                   ///< Mutex protecting the job state
+    std::condition_variable mJobCondition;  ///< Signals submitted and finished jobs
+    bool mJobPending;                       ///< A job has been submitted
+    bool mJobActive;                        ///< The worker executes a job
+    bool mTerminate;                        ///< Terminate the persistent worker
 };
 
 #endif // SIMPLETHREADHANDLER_H